@@ -0,0 +1,108 @@
+#pragma once
+#include "board.h"
+#include "generator.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Batch {
+
+/**
+ * Many positions stored as arrays of bitboards (structure of arrays)
+ *
+ * Plane p of position i is plane(p)[i], with planes in Board::positions
+ * order (PieceType), so a kernel streams one piece type of every position
+ * through contiguous memory. The lane count is padded to a multiple of
+ * LANE_ALIGN with empty positions, so kernels never need a scalar tail.
+ * Only the bitboards and packed info are kept (no keys, clocks or history).
+ */
+class Positions {
+public:
+    static constexpr int PLANES = 16;
+    static constexpr size_t LANE_ALIGN = 8;  // Bitboards in one AVX-512 register
+
+    explicit Positions(size_t count);
+
+    size_t size() const { return count; }
+
+    /**
+     * Lanes including padding: length of every plane and kernel output
+     */
+    size_t capacity() const { return lanes; }
+
+    void set(size_t index, const Board& board);
+    void get(size_t index, Board& board) const;
+
+    uint64_t* plane(int piece) { return data.data() + piece * lanes; }
+    const uint64_t* plane(int piece) const { return data.data() + piece * lanes; }
+
+    /**
+     * Board packed info (side to move, castling rights) per lane
+     */
+    uint8_t* info() { return packedInfo.data(); }
+    const uint8_t* info() const { return packedInfo.data(); }
+
+private:
+    size_t count;
+    size_t lanes;
+    std::vector<uint64_t> data;
+    std::vector<uint8_t> packedInfo;
+};
+
+/**
+ * Kernel instruction set, the best one is detected once at startup
+ */
+enum Kernel {
+    SCALAR,
+    AVX2,    // 4 positions per instruction
+    AVX512   // 8 positions per instruction
+};
+
+namespace Utils {
+    /**
+     * Widest kernel this CPU runs
+     */
+    Kernel bestKernel();
+
+    bool isSupported(Kernel kernel);
+    const char* kernelName(Kernel kernel);
+}
+
+/**
+ * Set-wise kernels over every lane of a batch
+ *
+ * Each kernel is one set-wise formula (shifts and masks, no table lookups)
+ * written once and compiled for every instruction set, so the scalar
+ * fallback and the vector versions always agree. Output arrays must hold
+ * capacity() entries.
+ */
+class Worker {
+public:
+    explicit Worker(Positions* positions, Kernel kernel = Utils::bestKernel());
+
+    /**
+     * Recompute the white_occ, black_occ and occ planes from the piece planes
+     */
+    void updateOccupancy();
+
+    /**
+     * Squares attacked by the pawns, knights and king of a side (everything but sliders)
+     */
+    void leaperAttacks(MoveGenerator::Color side, uint64_t* out);
+
+    /**
+     * Single and double pawn pushes of a side onto empty squares (target squares)
+     */
+    void pawnPushes(MoveGenerator::Color side, uint64_t* single, uint64_t* dbl);
+
+    /**
+     * Material balance (white minus black, Eval piece values, kings excluded)
+     */
+    void material(int* out);
+
+private:
+    Positions* positions;
+    Kernel kernel;
+};
+
+} // namespace Batch
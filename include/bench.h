@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace Bench {
+
+/**
+ * Positions searched by the bench command (FEN strings)
+ */
+extern const std::vector<std::string> positions;
+
+/**
+ * Run a fixed-depth search on every bench position and report
+ * nodes, speed and heap allocations made while searching (counted in
+ * CHESS_COUNT_ALLOCATIONS builds only)
+ * @param depth Search depth per position
+ */
+void run(int depth);
+
+/**
+ * Search every bench position for a fixed time with 1..maxThreads threads
+ * and report the nodes/second scaling relative to one thread
+ * @param maxThreads Highest thread count to measure
+ * @param moveTime Search time per position in ms
+ */
+void runThreads(int maxThreads, int moveTime);
+
+/**
+ * Drive a UCI::Protocol loop the way a GUI does (go infinite, isready, then
+ * stop after a varying delay) and report the time from sending stop to
+ * reading the bestmove line
+ * @param iterations Number of go/stop rounds
+ */
+void runStopLatency(int iterations);
+
+/**
+ * Play random games from the bench positions and compare the incremental
+ * evaluation against a full recompute after every make and unmake
+ * @param games Number of games to play
+ * @return true if every evaluation matched
+ */
+bool runEvalCheck(int games);
+
+/**
+ * Compute attack, push, occupancy and material planes for random positions,
+ * looping over Board objects and with each batch kernel, and report
+ * positions/sec (every kernel's output is checked against the Board loop)
+ * @param count Number of positions
+ * @return true if every kernel matched
+ */
+bool runBatch(int count);
+
+/**
+ * Number of global operator new calls since program start, or -1 unless
+ * built with CHESS_COUNT_ALLOCATIONS (the counting operator new is left out
+ * of regular builds)
+ */
+long long allocationCount();
+
+} // namespace Bench
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include "moves.h"
 #include "pieces.h"
@@ -23,14 +24,40 @@
 #define FILE_G 0x4040404040404040
 #define FILE_H 0x8080808080808080
 
+/**
+ * Most plies a board can hold in its state stack: the search depth plus
+ * quiescence. Earlier game moves only leave their keys in the game history
+ * (see Board::setRoot), so a copy of the board stays small
+ */
+constexpr int MAX_STACK_PLY = 128;
+
+/**
+ * Irreversible state saved by makeMove, one entry per ply
+ */
 struct UndoInfo {
-    uint64_t captured_piece_bb;
-    PieceType captured_piece_type;
     uint64_t old_en_passant;
-    uint8_t old_packed_info;
+    uint64_t old_key;
+    uint64_t old_pawn_key;
     Move move;
+    int8_t captured_piece_type;  // PieceType or -1
+    uint8_t old_packed_info;
+    uint8_t old_half_clock;
+};
+
+/**
+ * Attack maps of a position, filled in on demand by the move generator and
+ * kept per ply so they are still valid after unmakeMove returns to the node
+ */
+struct AttackInfo {
+    uint64_t attacked[2];  // Squares attacked by white [0] and black [1], seeing through the other king
+    uint64_t checkers;     // Pieces giving check to the side to move
+    uint8_t valid;         // ATTACKS_* flags of the fields that are up to date
 };
 
+constexpr uint8_t ATTACKS_WHITE = 1;
+constexpr uint8_t ATTACKS_BLACK = 2;
+constexpr uint8_t ATTACKS_CHECKERS = 4;
+
 class Board {
 public:
     Board();
@@ -62,6 +89,13 @@ public:
      */
     int getPieceAt(int square) const;
 
+    /**
+     * Mailbox lookup without bounds checks
+     * @param square The square (0-63)
+     * @return PieceType or -1 if empty
+     */
+    int pieceOn(int square) const { return _piece_on[square]; }
+
     bool isWhiteTurn();
     bool whiteCanCastleKS();
     bool whiteCanCastleQS();
@@ -88,6 +122,40 @@ public:
      */
     void unmakeMove();
     
+    /**
+     * Pass the turn: toggle the side to move and clear en passant,
+     * pushing a state entry (with a null move) like makeMove does
+     * @return false (board unchanged) if the state stack is full
+     */
+    bool makeNullMove();
+    
+    /**
+     * Take back a makeNullMove
+     */
+    void unmakeNullMove();
+    
+    /**
+     * Make the current position the bottom of the state stack: the moves on
+     * it can no longer be taken back and only their keys are kept, in the game
+     * history shared by copies of the board. Call it after every game move
+     */
+    void setRoot();
+    
+    /**
+     * Whether the current position repeats an earlier one, scanning the keys
+     * of the state stack, then of the game history, back to the last
+     * irreversible move (or null move)
+     * @param searchPly Plies since the search root: a repeat of a position at or
+     *                  after the root counts on its first recurrence, an older
+     *                  one only once it occurs for the third time
+     */
+    bool isRepetition(int searchPly) const;
+    
+    /**
+     * Whether the position was reached by makeNullMove
+     */
+    bool lastMoveIsNull() const { return _ply > 0 && _undo_stack[_ply - 1].move.isNull(); }
+    
     /**
      * Get a copy of positions (useful for saving state)
      */
@@ -98,7 +166,35 @@ public:
      * Get packed info (for saving/restoring state)
      */
     uint8_t getPackedInfo() const { return _packed_info; }
-    void setPackedInfo(uint8_t info) { _packed_info = info; }
+    void setPackedInfo(uint8_t info) { _packed_info = info; _refreshKeys(); _invalidateAttacks(); }
+    
+    /**
+     * Zobrist key of the position (pieces, castling rights, en passant file, side to move)
+     */
+    uint64_t getKey() const { return _key; }
+    
+    /**
+     * Zobrist key of the pawn structure only
+     */
+    uint64_t getPawnKey() const { return _pawn_key; }
+    
+    /**
+     * Running material + PST sums (white minus black) for the evaluation,
+     * middlegame and endgame flavours, and the game phase
+     */
+    int getPsqMg() const { return _psq_mg; }
+    int getPsqEg() const { return _psq_eg; }
+    int getPhase() const { return _phase; }
+    
+    /**
+     * Number of moves currently on the state stack
+     */
+    int getPly() const { return _ply; }
+    
+    /**
+     * Attack cache slot of the current position (see MoveGenerator::Worker::attackedBy)
+     */
+    AttackInfo& attackCache() { return _attack_cache[_ply]; }
 
 private:
     /**
@@ -113,9 +209,59 @@ private:
      * Bit 5 : Black can castle queen side
      */
     uint8_t _packed_info;
-    std::vector<UndoInfo> _undo_stack;
+    uint64_t _key;
+    uint64_t _pawn_key;
+    
+    /**
+     * Mailbox kept in sync with the bitboards, indexed 0-63, -1 when empty
+     */
+    int8_t _piece_on[64];
+    
+    int _psq_mg;
+    int _psq_eg;
+    int _phase;
+    
+    UndoInfo _undo_stack[MAX_STACK_PLY];
+    AttackInfo _attack_cache[MAX_STACK_PLY + 1];
+    int _ply;
+    
+    /**
+     * Keys of the game positions below the state stack, oldest first, back to
+     * the last irreversible move (null when empty). setRoot replaces it, it is
+     * never modified, so copies of the board share it
+     */
+    std::shared_ptr<const std::vector<uint64_t>> _history;
 
+    void _fenImport(const char *fen);
     void _fenImportBoard(const char *boardFen);
 
+    /**
+     * Recompute both Zobrist keys from scratch
+     */
+    void _refreshKeys();
+
+    /**
+     * Debug check: incremental keys, occupancy, mailbox and evaluation sums must match a full recompute
+     * (after every make and unmake in CHESS_VERIFY_STATE builds)
+     */
+    void _verifyState() const;
+
     void _updateOccupancy();
+
+    /**
+     * Drop the cached attack maps of the current position (after editing it in place)
+     */
+    void _invalidateAttacks() { _attack_cache[_ply].valid = 0; }
+
+    /**
+     * Rebuild the mailbox and evaluation sums from the bitboards
+     */
+    void _refreshPieceInfo();
+
+    /**
+     * Bitboard, occupancy, mailbox and evaluation sum updates for a single piece (keys are left alone)
+     */
+    inline void _addPiece(int pieceType, int square);
+    inline void _removePiece(int pieceType, int square);
+    inline void _movePiece(int pieceType, int from, int to);
 };
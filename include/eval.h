@@ -12,6 +12,9 @@ namespace Eval {
     constexpr int QUEEN_VALUE = 900;
     constexpr int KING_VALUE = 20000;
     
+    // Game phase: N = B = 1, R = 2, Q = 4, so the starting position is PHASE_MAX
+    constexpr int PHASE_MAX = 24;
+    
     // Piece-square tables (from white's perspective)
     // Values are in centipawns, indexed [square] where square is 0-63
     namespace Tables {
@@ -22,6 +25,15 @@ namespace Eval {
         extern const int queen_table[64];
         extern const int king_middlegame_table[64];
         extern const int king_endgame_table[64];
+        
+        // Material + PST per piece and square, signed from white's point of view
+        // (black squares already mirrored). Board sums these incrementally.
+        struct PSQTable {
+            int mg[12][64];
+            int eg[12][64];
+        };
+        extern const PSQTable psq;
+        extern const int phase_weight[12];
     }
     
     /**
@@ -33,8 +45,8 @@ namespace Eval {
         
         /**
          * Evaluate the current position
-         * @return Score in centipawns from white's perspective
-         *         Positive = white is better, Negative = black is better
+         * Tapered blend of the middlegame and endgame sums kept up to date by the board
+         * @return Score in centipawns from the side to move's perspective
          */
         int evaluate();
         
@@ -44,10 +56,16 @@ namespace Eval {
         int evaluateMaterial();
         
         /**
-         * Evaluate material with piece-square tables
+         * Evaluate material with piece-square tables, recomputed from scratch
+         * Must always equal evaluate() (asserted there in CHESS_VERIFY_STATE builds)
          */
         int evaluateWithPST();
         
+        /**
+         * Game phase from the remaining pieces, PHASE_MAX (opening) down to 0
+         */
+        int getGamePhase();
+        
         /**
          * Check if position is in endgame
          */
@@ -58,13 +76,13 @@ namespace Eval {
         
         // Helper functions
         int getMaterialScore();
-        int getPieceSquareScore();
+        int getPieceSquareScore(bool endgame);
         int getMobilityScore();
         int getPawnStructureScore();
         int getKingSafetyScore();
         
-        // Get piece-square value for a piece at a square
-        int getPSTValue(PieceType piece, int square);
+        // Get piece-square value for a (white) piece at a square
+        int getPSTValue(PieceType piece, int square, bool endgame);
         
         // Count total material on board (for endgame detection)
         int getTotalMaterial();
@@ -79,5 +97,11 @@ namespace Eval {
         
         // Get piece value
         int getPieceValue(PieceType piece);
+        
+        // Blend middlegame and endgame scores by game phase
+        inline int taper(int mg, int eg, int phase) {
+            if (phase > PHASE_MAX) phase = PHASE_MAX;
+            return (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+        }
     }
 }
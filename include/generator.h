@@ -1,33 +1,175 @@
 #pragma once
 #include "board.h"
 #include "moves.h"
+#include <array>
+#include <atomic>
 #include <vector>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 
 namespace MoveGenerator {
     
     /**
-     * Pre-computed attack tables for sliding pieces
+     * How slider attacks are looked up (every lookup gives the same answers)
+     */
+    enum SliderLookup {
+        LOOKUP_MAGIC,
+        LOOKUP_PEXT,   // Needs BMI2
+        LOOKUP_RAYS    // Walk the rays on every call, slow, for checking the tables
+    };
+    
+    /**
+     * Pre-computed attack tables, generated at compile time
+     *
+     * Sliding pieces use fancy magic bitboards: the relevant blockers of a
+     * square are hashed into a per-square slice of a shared table. On CPUs
+     * with fast BMI2 the hash is replaced by PEXT, chosen once at startup.
+     * Both layouts are baked into the binary, so startup does no table work.
      */
     class AttackTables {
     public:
-        static void initialize();
         static uint64_t getRookAttacks(int square, uint64_t occupancy);
         static uint64_t getBishopAttacks(int square, uint64_t occupancy);
         static uint64_t getQueenAttacks(int square, uint64_t occupancy);
-        static uint64_t getKnightAttacks(int square);
-        static uint64_t getKingAttacks(int square);
-        static uint64_t getWhitePawnAttacks(int square);
-        static uint64_t getBlackPawnAttacks(int square);
+        static uint64_t getKnightAttacks(int square) { return knight_attacks[square]; }
+        static uint64_t getKingAttacks(int square) { return king_attacks[square]; }
+        static uint64_t getWhitePawnAttacks(int square) { return white_pawn_attacks[square]; }
+        static uint64_t getBlackPawnAttacks(int square) { return black_pawn_attacks[square]; }
+        
+        /**
+         * Squares strictly between two aligned squares (0 if not on a common line)
+         */
+        static uint64_t getBetween(int from, int to) { return between_bb[from][to]; }
+        
+        /**
+         * Full rank, file or diagonal through two aligned squares (0 if not aligned)
+         */
+        static uint64_t getLine(int from, int to) { return line_bb[from][to]; }
+        
+        /**
+         * Whether slider lookups index with PEXT instead of magic multiplication
+         */
+        static bool usesPext() { return getLookup() == LOOKUP_PEXT; }
+        
+        /**
+         * Current slider lookup, PEXT where it is fast and magic otherwise
+         */
+        static SliderLookup getLookup() { return lookup.load(std::memory_order_relaxed); }
+        
+        /**
+         * Switch the slider lookup of every thread (safe during a search, the
+         * answers do not change)
+         * @return false (lookup unchanged) if this CPU cannot run it
+         */
+        static bool setLookup(SliderLookup mode);
+        
+        static bool isSupported(SliderLookup mode);
+        
+        /**
+         * Compare the magic and PEXT tables against the ray walk for every
+         * square and every subset of its relevant blockers (PEXT only where
+         * the CPU has BMI2). Run on demand by perft tables, never at startup
+         * @return Number of table entries that disagree
+         */
+        static int verify();
+        
+        struct Magic {
+            uint64_t mask;      // Relevant blockers (board edges excluded)
+            uint64_t magic;
+            unsigned offset;    // Start of this square's slice of the table
+            int shift;
+        };
+        
+        static constexpr int ROOK_TABLE_SIZE = 102400;
+        static constexpr int BISHOP_TABLE_SIZE = 5248;
         
     private:
-        static uint64_t knight_attacks[64];
-        static uint64_t king_attacks[64];
-        static uint64_t white_pawn_attacks[64];
-        static uint64_t black_pawn_attacks[64];
-        static bool initialized;
-        
-        static uint64_t computeRookAttacks(int square, uint64_t blockers);
-        static uint64_t computeBishopAttacks(int square, uint64_t blockers);
+        using Table = std::array<uint64_t, 64>;
+        using PairTable = std::array<std::array<uint64_t, 64>, 64>;
+        
+        static const Table knight_attacks;
+        static const Table king_attacks;
+        static const Table white_pawn_attacks;
+        static const Table black_pawn_attacks;
+        static const PairTable between_bb;
+        static const PairTable line_bb;
+        static const std::array<Magic, 64> rook_magics;
+        static const std::array<Magic, 64> bishop_magics;
+        static const std::array<uint64_t, ROOK_TABLE_SIZE> rook_table;
+        static const std::array<uint64_t, ROOK_TABLE_SIZE> rook_pext_table;
+        static const std::array<uint64_t, BISHOP_TABLE_SIZE> bishop_table;
+        static const std::array<uint64_t, BISHOP_TABLE_SIZE> bishop_pext_table;
+        static std::atomic<SliderLookup> lookup;
+        
+        static unsigned pext(uint64_t occupancy, uint64_t mask);
+        static uint64_t rookRays(int square, uint64_t occupancy);
+        static uint64_t bishopRays(int square, uint64_t occupancy);
+    };
+    
+    inline unsigned AttackTables::pext(uint64_t occupancy, uint64_t mask) {
+#if defined(__BMI2__)
+        return static_cast<unsigned>(_pext_u64(occupancy, mask));
+#elif defined(__x86_64__)
+        uint64_t result;
+        asm("pextq %2, %1, %0" : "=r"(result) : "r"(occupancy), "r"(mask));
+        return static_cast<unsigned>(result);
+#else
+        (void)occupancy; (void)mask;
+        return 0;  // Never called, PEXT is not supported off x86-64
+#endif
+    }
+    
+    inline uint64_t AttackTables::getRookAttacks(int square, uint64_t occupancy) {
+        const Magic& m = rook_magics[square];
+        SliderLookup mode = getLookup();
+        if (mode == LOOKUP_RAYS) [[unlikely]] return rookRays(square, occupancy);
+        if (mode == LOOKUP_PEXT) return rook_pext_table[m.offset + pext(occupancy, m.mask)];
+        return rook_table[m.offset + (((occupancy & m.mask) * m.magic) >> m.shift)];
+    }
+    
+    inline uint64_t AttackTables::getBishopAttacks(int square, uint64_t occupancy) {
+        const Magic& m = bishop_magics[square];
+        SliderLookup mode = getLookup();
+        if (mode == LOOKUP_RAYS) [[unlikely]] return bishopRays(square, occupancy);
+        if (mode == LOOKUP_PEXT) return bishop_pext_table[m.offset + pext(occupancy, m.mask)];
+        return bishop_table[m.offset + (((occupancy & m.mask) * m.magic) >> m.shift)];
+    }
+    
+    inline uint64_t AttackTables::getQueenAttacks(int square, uint64_t occupancy) {
+        return getRookAttacks(square, occupancy) | getBishopAttacks(square, occupancy);
+    }
+    
+    /**
+     * Which subset of the moves to generate
+     */
+    enum GenType {
+        GEN_ALL,
+        GEN_CAPTURES,  // Captures, all promotions to a queen and en passant
+        GEN_QUIETS,    // Everything else (including push underpromotions)
+        GEN_EVASIONS   // All legal moves while in check (no castling)
+    };
+    
+    enum Color {
+        WHITE,
+        BLACK
+    };
+    
+    /**
+     * Piece type of the given colour from its white counterpart (e.g. white_rook -> black_rook)
+     */
+    constexpr PieceType pieceOf(Color c, PieceType whitePiece) {
+        return static_cast<PieceType>(whitePiece + (c == BLACK ? 6 : 0));
+    }
+    
+    /**
+     * Checkers and pins of the side to move, computed once per position
+     */
+    struct CheckInfo {
+        uint64_t checkers;   // Enemy pieces giving check
+        uint64_t pinned;     // Own pieces pinned to the king
+        uint64_t checkMask;  // Destinations that answer a single check (all squares when not in check)
+        int kingSquare;
     };
     
     /**
@@ -38,44 +180,105 @@ namespace MoveGenerator {
         explicit Worker(Board* board);
         
         // Generate all pseudo-legal moves
-        std::vector<Move> generateAllMoves();
+        void generateAllMoves(MoveList& moves);
         
         // Generate only captures
-        std::vector<Move> generateCaptures();
+        void generateCaptures(MoveList& moves);
+        
+        // Generate only legal moves (check evasions when in check)
+        void generateLegalMoves(MoveList& moves);
+        
+        // Generate only legal captures (and en passant, push promotions to a queen)
+        void generateLegalCaptures(MoveList& moves);
+        
+        // Generate only legal non-captures (pushes and push underpromotions, castling)
+        void generateLegalQuiets(MoveList& moves);
+        
+        // Find checkers and pinned pieces of the side to move
+        CheckInfo computeCheckInfo();
+        
+        // All pieces of both colours attacking a square, given an occupancy
+        uint64_t attackersTo(int square, uint64_t occupancy);
+        
+        // Squares attacked by a side, its sliders seeing through the other king
+        // Computed once per position and cached on the board, like checkers()
+        uint64_t attackedBy(Color side);
         
-        // Check if a move is pseudo-legal
+        // Pieces giving check to the side to move
+        uint64_t checkers();
+        
+        // Check if a move is pseudo-legal (one of generateAllMoves), without generating
+        // Meant for moves from elsewhere: hash moves, killers
         bool isPseudoLegal(const Move& move);
         
-        // Check if a move is fully legal (doesn't leave king in check)
+        // Check if a move is fully legal (doesn't leave king in check), without generating
         bool isLegal(const Move& move);
         
+        // Static exchange evaluation: does the capture sequence started by the move
+        // win at least threshold centipawns? Sliders behind the capturers (x-rays) join in
+        bool seeGE(const Move& move, int threshold = 0);
+        
         // Check if a square is attacked by the given side
         bool isSquareAttacked(int square, bool byWhite);
         
         // Check if the current side to move is in check
         bool isInCheck();
         
-        // Filter pseudo-legal moves to only legal moves
-        std::vector<Move> filterLegalMoves(const std::vector<Move>& pseudoMoves);
+        // Filter pseudo-legal moves to only legal moves (in place)
+        // Reference for the legal generator, see perft verify
+        void filterLegalMoves(MoveList& moves);
         
     private:
         Board* board;
         
-        // Generate moves for specific piece types
-        void generatePawnMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateKnightMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateBishopMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateRookMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateQueenMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateKingMoves(std::vector<Move>& moves, bool capturesOnly = false);
-        void generateCastlingMoves(std::vector<Move>& moves);
+        // Colour and move type are template parameters so side-dependent
+        // shifts, ranks and masks are constants; dispatch happens once per call.
+        // With a CheckInfo only legal moves are emitted, without one pseudo-legal moves
+        template<Color Us, GenType Type>
+        void generateLegal(MoveList& moves);
+        
+        template<Color Us>
+        CheckInfo computeCheckInfo();
+        
+        template<Color Us, GenType Type>
+        void generateMoves(MoveList& moves, const CheckInfo* info);
+        
+        // Pawns are generated set-wise: the whole bitboard is shifted per direction
+        template<Color Us, GenType Type>
+        void generatePawnMoves(MoveList& moves, const CheckInfo* info);
+        
+        // Serialize pawn targets reached by moving Delta squares (Type picks the promotions)
+        template<int Delta, GenType Type = GEN_ALL>
+        void addPawnMoves(MoveList& moves, uint64_t targets, const CheckInfo* info, bool promotion);
+        
+        // Knights, bishops, rooks and queens (Piece is the white piece type)
+        template<Color Us, PieceType Piece>
+        void generatePieceMoves(MoveList& moves, uint64_t targets, const CheckInfo* info);
+        
+        template<Color Us>
+        void generateKingMoves(MoveList& moves, uint64_t targets, const CheckInfo* info);
+        
+        template<Color Us>
+        void generateCastlingMoves(MoveList& moves);
+        
+        template<Color Us>
+        uint64_t computeAttacks();
+        
+        // Whether attackedBy(side) is already cached for this position
+        bool hasAttackMap(Color side);
+        
+        template<Color Us>
+        bool isPseudoLegal(const Move& move);
+        
+        template<Color Us>
+        bool isCastlingPseudoLegal(int from, int to);
         
         // Helper functions
-        void addMovesFromBitboard(std::vector<Move>& moves, int from, uint64_t targets, 
-                                   const std::string& pieceSymbol);
-        void addPawnPromotions(std::vector<Move>& moves, int from, int to, bool isCapture);
-        std::string squareToAlgebraic(int square);
-        int algebraicToSquare(const std::string& algebraic);
+        uint64_t legalTargets(int from, uint64_t targets, const CheckInfo* info);
+        bool isEnPassantLegal(int from, int to);
+        void addMovesFromBitboard(MoveList& moves, int from, uint64_t targets);
+        template<GenType Type>
+        void addPawnPromotions(MoveList& moves, int from, int to);
     };
     
     /**
@@ -0,0 +1,82 @@
+#pragma once
+#include "board.h"
+#include "generator.h"
+#include "moves.h"
+
+namespace Search {
+
+/**
+ * Staged move picker
+ *
+ * Moves are handed out one at a time and each stage is generated only when
+ * the previous one runs dry, so a node that cuts off on the hash move or an
+ * early capture never generates (or orders) the quiet moves. Within a stage
+ * the best remaining move is selected instead of sorting the whole list.
+ */
+class MovePicker {
+public:
+    /**
+     * Main search: hash move, good captures, killers, quiets by history, bad captures
+     * @param killers The two killer moves of this ply
+     * @param history [from][to] history scores
+     */
+    MovePicker(Board* board, MoveGenerator::Worker* moveGen, const Move& hashMove,
+               const Move killers[2], const int (*history)[64]);
+
+    /**
+     * Quiescence: captures only, most valuable victim first
+     */
+    MovePicker(Board* board, MoveGenerator::Worker* moveGen);
+
+    /**
+     * @return The next legal move, or a null move when every stage is used up
+     */
+    Move next();
+
+private:
+    enum Stage {
+        HASH_MOVE,
+        INIT_CAPTURES,
+        GOOD_CAPTURES,
+        KILLER_1,
+        KILLER_2,
+        INIT_QUIETS,
+        QUIETS,
+        BAD_CAPTURES,
+        Q_INIT_CAPTURES,
+        Q_CAPTURES,
+        DONE
+    };
+
+    Board* board;
+    MoveGenerator::Worker* moveGen;
+    Move hashMove;
+    Move killers[2];
+    const int (*history)[64];
+    int stage;
+
+    // Captures occupy [0, captureEnd), quiets are appended after them.
+    // Bad captures score below zero and are left in place for the last stage.
+    MoveList moves;
+    int current;
+    int captureEnd;
+    int badCurrent;
+
+    /**
+     * Swap the best scored move of [current, end) into current
+     */
+    ScoredMove& selectBest(int end);
+
+    void scoreCaptures(bool splitBad);
+    void scoreQuiets();
+
+    bool isCapture(const Move& move) const;
+    bool isKiller(const Move& move) const;
+
+    /**
+     * Killer from another node: must still be a legal quiet move here
+     */
+    bool isUsableKiller(const Move& move);
+};
+
+} // namespace Search
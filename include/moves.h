@@ -1,23 +1,99 @@
 #pragma once
-#include <string>
+#include <cstdint>
 #include "pieces.h"
 
 enum MoveType {
     NORMAL,
-    CAPTURE,
+    PROMOTION,
     EN_PASSANT,
-    CASTLING,
-    PROMOTION
+    CASTLING
 };
 
+/**
+ * Packed 16-bit move, cheap to copy through move lists and the undo stack
+ *
+ * From LSB to MSB
+ *
+ * Bit 0-5   : From square (0-63)
+ * Bit 6-11  : To square (0-63)
+ * Bit 12-13 : MoveType
+ * Bit 14-15 : Promotion piece (0 = rook, 1 = knight, 2 = bishop, 3 = queen)
+ *
+ * Captures are not flagged, the board is the source of truth for them.
+ * The all-zero value (a1a1) is never a real move and is used as "no move".
+ */
 struct Move {
-    int from;           // 1-64 (1-based)
-    int to;             // 1-64 (1-based)
-    std::string notation;
-    MoveType type;
-    PieceType promotionPiece; // Only used if type == PROMOTION
+    uint16_t data;
+
+    constexpr Move() : data(0) {}
+    constexpr Move(int from, int to, MoveType type = NORMAL, PieceType promotion = white_queen)
+        : data(static_cast<uint16_t>(from | (to << 6) | (type << 12) |
+                                     (type == PROMOTION ? (promotion % 6 - 1) << 14 : 0))) {}
+
+    constexpr int from() const { return data & 0x3F; }
+    constexpr int to() const { return (data >> 6) & 0x3F; }
+    constexpr MoveType type() const { return static_cast<MoveType>((data >> 12) & 0x3); }
+
+    /**
+     * @param isWhite Colour of the promoting side
+     * @return The piece the pawn turns into (only meaningful for PROMOTION)
+     */
+    constexpr PieceType promotionPiece(bool isWhite) const {
+        return static_cast<PieceType>((isWhite ? white_pawn : black_pawn) + (data >> 14) + 1);
+    }
+
+    constexpr bool isNull() const { return data == 0; }
+    constexpr bool operator==(const Move& other) const { return data == other.data; }
+    constexpr bool operator!=(const Move& other) const { return data != other.data; }
+};
+
+static_assert(sizeof(Move) == 2, "Move must stay packed in 16 bits");
+
+constexpr int MAX_MOVES = 256;
+
+/**
+ * Move ordering helper
+ */
+struct ScoredMove {
+    Move move;
+    int score;
+    
+    ScoredMove() : score(0) {}
+    ScoredMove(const Move& m, int s) : move(m), score(s) {}
+    
+    bool operator<(const ScoredMove& other) const {
+        return score > other.score;  // Higher score = better move
+    }
+};
+
+/**
+ * Fixed-capacity move list living on the stack of the node that owns it
+ *
+ * Storage is left uninitialized so declaring one per node costs nothing,
+ * and the score slot lets move ordering work in place.
+ */
+class MoveList {
+public:
+    MoveList() : count(0) {}
+    
+    void push_back(const Move& move) { moves[count++] = ScoredMove(move, 0); }
+    void clear() { count = 0; }
+    void resize(int size) { count = size; }  // Shrink only
+    
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+    ScoredMove& operator[](int i) { return moves[i]; }
+    const ScoredMove& operator[](int i) const { return moves[i]; }
+    
+    ScoredMove* begin() { return moves; }
+    ScoredMove* end() { return moves + count; }
+    const ScoredMove* begin() const { return moves; }
+    const ScoredMove* end() const { return moves + count; }
     
-    Move() : from(0), to(0), notation(""), type(NORMAL), promotionPiece(white_pawn) {}
-    Move(int f, int t, std::string n, MoveType mt = NORMAL) 
-        : from(f), to(t), notation(n), type(mt), promotionPiece(white_pawn) {}
+private:
+    union {
+        ScoredMove moves[MAX_MOVES];
+    };
+    int count;
 };
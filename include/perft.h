@@ -0,0 +1,130 @@
+#pragma once
+#include "board.h"
+#include "generator.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Perft {
+
+/**
+ * A position with a known node count at a given depth
+ */
+struct SuiteEntry {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+/**
+ * Subtree counts keyed by position and depth, shared by perft threads
+ *
+ * Same scheme as the transposition table: each entry stores (key ^ data)
+ * next to data, so a torn write from another thread is just a miss.
+ * Data packs the node count (56 bits) with the depth (8 bits).
+ */
+class HashTable {
+public:
+    /**
+     * @param megabytes Table size in MB (16-byte entries)
+     */
+    explicit HashTable(size_t megabytes);
+    
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const;
+    void store(uint64_t key, int depth, uint64_t nodes);
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+    
+    std::unique_ptr<Entry[]> entries;
+    size_t count;
+    
+    Entry& entryFor(uint64_t key) const;
+};
+
+/**
+ * Move path enumeration for verifying and benchmarking move generation
+ */
+class Worker {
+public:
+    /**
+     * @param hash Optional table of subtree counts (may be shared between workers)
+     */
+    explicit Worker(Board* board, HashTable* hash = nullptr);
+    
+    /**
+     * Count leaf nodes of the legal move tree
+     * Moves at depth 1 are counted without being made (bulk counting)
+     * @param depth Depth in plies (>= 1)
+     */
+    uint64_t perft(int depth);
+    
+    /**
+     * Print the node count below every root move, then the total and speed
+     * @param depth Depth in plies (>= 1)
+     * @return Total node count
+     */
+    uint64_t divide(int depth);
+    
+    /**
+     * Run perft and print total nodes, time and nodes/sec
+     */
+    uint64_t run(int depth);
+    
+    /**
+     * Walk the tree comparing the legal generator against the pseudo-legal
+     * generator filtered by make/unmake at every node, and against legal
+     * captures + legal quiets. isPseudoLegal and isLegal are checked against
+     * the generated lists, for this node's moves and the grandparent's, and
+     * the legal moves and direct checks again with the attack maps cached
+     * @param depth Depth in plies (>= 1)
+     * @return Number of nodes where the move sets or checks disagree
+     */
+    uint64_t verify(int depth, const MoveList* grandparent = nullptr, const MoveList* parent = nullptr);
+
+private:
+    Board* board;
+    MoveGenerator::Worker moveGen;
+    HashTable* hash;
+};
+
+/**
+ * Perft split over several threads, each with its own board copy
+ *
+ * The first plies are expanded into a queue of move paths, and threads keep
+ * taking the next path until the queue is empty, so a thread that got small
+ * subtrees picks up more work. Prints total nodes, time and nodes/sec.
+ * @param threads Number of threads (>= 1)
+ * @param hashMb Size of the shared subtree table in MB (0 = none)
+ * @return Total node count
+ */
+uint64_t runThreads(const Board& root, int depth, int threads, size_t hashMb);
+
+/**
+ * Run perft on every standard suite position and compare against the known counts
+ * @param maxDepth Entries deeper than this are skipped (0 = no limit)
+ * @return true if every count matched
+ */
+bool runSuite(int maxDepth = 0);
+
+/**
+ * Run verify on every standard suite position
+ * @param maxDepth Entries are verified to at most this depth
+ * @return true if the generators agreed everywhere
+ */
+bool runVerify(int maxDepth);
+
+/**
+ * Check the slider tables: every magic and PEXT entry against the ray walk,
+ * then the suite with each lookup (rays, magic, PEXT where supported), so
+ * the table-free ray path is compared with the known counts too
+ * @param maxDepth Suite entries deeper than this are skipped (0 = no limit)
+ * @return true if every entry and every count matched
+ */
+bool runTables(int maxDepth = 0);
+
+} // namespace Perft
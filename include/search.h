@@ -4,6 +4,8 @@
 #include "generator.h"
 #include "eval.h"
 #include "moves.h"
+#include "tt.h"
+#include "movepick.h"
 #include <vector>
 #include <chrono>
 #include <atomic>
@@ -13,7 +15,6 @@ namespace Search {
 
 // Constants
 constexpr int MAX_PLY = 64;
-constexpr int MAX_MOVES = 256;
 constexpr int INFINITY_SCORE = 100000;
 constexpr int MATE_SCORE = 99000;
 constexpr int MATE_THRESHOLD = 98000;
@@ -67,6 +68,7 @@ struct SearchLimits {
     int moveTime;              // Time allocated for this move (ms)
     long long maxNodes;
     bool infinite;
+    bool ponder;               // Searching the predicted reply, clock starts on ponderhit
     
     // Time controls
     int wtime;
@@ -75,24 +77,11 @@ struct SearchLimits {
     int binc;
     int movestogo;
     
-    SearchLimits() 
-        : maxDepth(MAX_PLY), moveTime(-1), maxNodes(-1), infinite(false),
-        wtime(-1), btime(-1), winc(0), binc(0), movestogo(-1) {}
-};
-
-/**
- * Move ordering helper
- */
-struct ScoredMove {
-    Move move;
-    int score;
-    
-    ScoredMove() : score(0) {}
-    ScoredMove(const Move& m, int s) : move(m), score(s) {}
+    int contempt;              // Centipawns a draw is worth less than zero to the side to move at the root
     
-    bool operator<(const ScoredMove& other) const {
-        return score > other.score;  // Higher score = better move
-    }
+    SearchLimits() 
+        : maxDepth(MAX_PLY), moveTime(-1), maxNodes(-1), infinite(false), ponder(false),
+        wtime(-1), btime(-1), winc(0), binc(0), movestogo(-1), contempt(0) {}
 };
 
 /**
@@ -100,7 +89,11 @@ struct ScoredMove {
  */
 class Worker {
 public:
-    Worker(Board* board, MoveGenerator::Worker* moveGen, Eval::Worker* evaluator);
+    /**
+     * @param threadId 0 for the main thread, helpers (>0) stay silent and vary their depths
+     */
+    Worker(Board* board, MoveGenerator::Worker* moveGen, Eval::Worker* evaluator, 
+           TranspositionTable* tt, int threadId = 0);
     
     /**
      * Start iterative deepening search
@@ -114,6 +107,28 @@ public:
      */
     void stop();
     
+    /**
+     * The opponent played the pondered move: switch to normal time management
+     */
+    void ponderhit();
+    
+    /**
+     * Re-arm the stop flag and ponder state before a new search
+     * Called from the launching thread, not by search(), so a stop or
+     * ponderhit that arrives before the search thread gets going is kept
+     */
+    void prepare(bool ponder);
+    
+    /**
+     * Workers whose node counts are added to this one's info output
+     */
+    void setPeers(const std::vector<const Worker*>& workers) { peers = workers; }
+    
+    /**
+     * Nodes searched so far, safe to read from other threads
+     */
+    long long nodesSearched() const { return publishedNodes.load(std::memory_order_relaxed); }
+    
     /**
      * Check if search is stopped
      */
@@ -128,12 +143,22 @@ private:
     Board* board;
     MoveGenerator::Worker* moveGen;
     Eval::Worker* evaluator;
+    TranspositionTable* tt;
+    int threadId;
+    std::vector<const Worker*> peers;
     
     // Search state
     std::atomic<bool> stopped;
+    alignas(64) std::atomic<long long> publishedNodes;
     SearchStats stats;
     SearchLimits currentLimits;
     
+    bool rootWhite;
+    
+    // Null move verification: no null moves for the verified side before this ply
+    int nmpMinPly;
+    bool nmpWhite;
+    
     // Move ordering data
     Move killerMoves[MAX_PLY][2];     // Two killer moves per ply
     int historyTable[64][64];          // [from][to] history heuristic
@@ -143,6 +168,13 @@ private:
     // Time management
     std::chrono::steady_clock::time_point searchStartTime;
     int allocatedTime;
+    std::atomic<bool> pondering;
+    std::atomic<long long> ponderhitTicks;  // steady_clock ticks at ponderhit, 0 if none
+    
+    /**
+     * Time charged against the allocation (excludes time spent pondering)
+     */
+    long long timeUsedMs() const;
     
     /**
      * Alpha-beta search with negamax framework
@@ -155,14 +187,14 @@ private:
     int quiescence(int alpha, int beta, int ply);
     
     /**
-     * Score moves for move ordering
+     * Draw by repetition or the fifty-move rule (checkmate on the last move still counts)
      */
-    void scoreMoves(std::vector<ScoredMove>& moves, int ply, const Move& hashMove);
+    bool isDraw(int ply);
     
     /**
-     * Get MVV-LVA score for captures
+     * Score of a draw for the side to move, shifted by the contempt setting
      */
-    int getMvvLvaScore(const Move& move);
+    int drawScore();
     
     /**
      * Update killer moves
@@ -201,8 +233,9 @@ private:
     
     /**
      * Send UCI info output
+     * @param bound BOUND_LOWER / BOUND_UPPER while re-searching after an aspiration fail
      */
-    void sendInfo(int depth, int score, const std::vector<Move>& pv);
+    void sendInfo(int depth, int score, const std::vector<Move>& pv, Bound bound = BOUND_EXACT);
 };
 
 } // namespace Search
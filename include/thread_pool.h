@@ -0,0 +1,79 @@
+#pragma once
+
+#include "board.h"
+#include "generator.h"
+#include "eval.h"
+#include "search.h"
+#include "tt.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Search {
+
+/**
+ * Everything one search thread owns: its own board copy, move generator,
+ * evaluator and search worker (killer, history and PV tables)
+ */
+struct SearchThread {
+    Board board;
+    MoveGenerator::Worker moveGen;
+    Eval::Worker evaluator;
+    Worker searcher;
+    SearchResult result;
+    std::thread thread;
+    
+    SearchThread(TranspositionTable* tt, int threadId);
+};
+
+/**
+ * Lazy SMP: all threads search the same root and share only the
+ * transposition table; helpers are spread over depths so they fill it
+ * with useful entries for the main thread
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(TranspositionTable* tt);
+    ~ThreadPool();
+    
+    /**
+     * Set the number of search threads (including the main one)
+     */
+    void setThreadCount(int count);
+    
+    int getThreadCount() const { return static_cast<int>(threads.size()); }
+    
+    /**
+     * Copy the root position to every thread and arm their stop/ponder state
+     * Must run on the launching thread before run() starts elsewhere
+     */
+    void prepare(const Board& root, const SearchLimits& limits);
+    
+    /**
+     * Search the prepared position on all threads
+     * The main thread runs on the caller, helpers are stopped once it returns
+     * @return The best result across threads, with nodes summed over all of them
+     */
+    SearchResult run(const SearchLimits& limits);
+    
+    /**
+     * prepare() followed by run() on the calling thread
+     */
+    SearchResult search(const Board& root, const SearchLimits& limits);
+    
+    /**
+     * Stop every thread
+     */
+    void stop();
+    
+    /**
+     * Forward ponderhit to the main thread (helpers have no time limit)
+     */
+    void ponderhit();
+
+private:
+    TranspositionTable* tt;
+    std::vector<std::unique_ptr<SearchThread>> threads;
+};
+
+} // namespace Search
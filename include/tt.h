@@ -0,0 +1,106 @@
+#pragma once
+#include "moves.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Search {
+
+enum Bound : uint8_t {
+    BOUND_NONE,
+    BOUND_UPPER,    // Fail low: score <= stored value
+    BOUND_LOWER,    // Fail high: score >= stored value
+    BOUND_EXACT
+};
+
+/**
+ * Decoded transposition table entry
+ */
+struct TTData {
+    Move move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+/**
+ * Shared transposition table
+ *
+ * Buckets of four 16-byte entries fill one cache line. Each entry stores
+ * (key ^ data) next to data, so a torn write from another thread fails the
+ * key check on probe instead of returning mixed fields; no locks are taken.
+ */
+class TranspositionTable {
+public:
+    TranspositionTable();
+    
+    /**
+     * Reallocate the table (contents are lost)
+     * @param megabytes Table size in MB
+     */
+    void resize(size_t megabytes);
+    
+    /**
+     * Wipe all entries
+     */
+    void clear();
+    
+    /**
+     * Advance the age so entries from earlier searches are replaced first
+     */
+    void newSearch();
+    
+    /**
+     * Look up a position
+     * @return true if an entry with this key was found
+     */
+    bool probe(uint64_t key, TTData& data) const;
+    
+    /**
+     * Store a search result, replacing the shallowest / oldest entry of the bucket
+     */
+    void store(uint64_t key, const Move& move, int score, int depth, Bound bound);
+    
+    /**
+     * Fill rate of entries from the current search in permille (UCI hashfull)
+     */
+    int hashfull() const;
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+    
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+    
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount;
+    uint8_t generation;     // 6 bits used
+    
+    Bucket& bucketFor(uint64_t key) const;
+    
+    /**
+     * From LSB to MSB
+     *
+     * Bit 0-15  : Move
+     * Bit 16-47 : Score (signed)
+     * Bit 48-55 : Depth
+     * Bit 56-57 : Bound
+     * Bit 58-63 : Generation
+     */
+    static uint64_t pack(const Move& move, int score, int depth, Bound bound, uint8_t generation);
+    static TTData unpack(uint64_t data);
+    static uint8_t generationOf(uint64_t data) { return static_cast<uint8_t>(data >> 58); }
+};
+
+/**
+ * Mate scores are stored relative to the node, not the root
+ */
+int scoreToTT(int score, int ply);
+int scoreFromTT(int score, int ply);
+
+} // namespace Search
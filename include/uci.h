@@ -1,13 +1,17 @@
 #pragma once
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "board.h"
 #include "generator.h"
 #include "eval.h"
 #include "search.h"
+#include "thread_pool.h"
 
 namespace UCI {
 
@@ -47,16 +51,28 @@ public:
     void setPosition(const std::string& fen, const std::vector<std::string>& moves);
     
     /**
-     * Start searching for the best move
+     * Start searching for the best move in the background
+     * Returns immediately, the search thread sends bestmove when done
      * @param limits Search constraints and time management
      */
     void startSearch(const Search::SearchLimits& limits);
     
     /**
-     * Stop the current search
+     * Stop the current search and wait until its bestmove has been sent
      */
     void stopSearch();
     
+    /**
+     * The opponent played the pondered move: start the clock
+     */
+    void ponderHit();
+    
+    /**
+     * Wait for the current search to finish on its own
+     * Searches that only end on 'stop' (infinite / ponder) are stopped
+     */
+    void waitForSearch();
+    
     /**
      * Check if engine is currently searching
      */
@@ -81,18 +97,30 @@ public:
      * Get current engine options
      */
     const EngineOptions& getOptions() const { return options; }
+    
+    /**
+     * Get the current position
+     */
+    const Board& getBoard() const { return *board; }
 
 private:
     std::unique_ptr<Board> board;
     std::unique_ptr<MoveGenerator::Worker> moveGen;
-    std::unique_ptr<Eval::Worker> evaluator;
-    std::unique_ptr<Search::Worker> searcher;
+    Search::TranspositionTable tt;
+    Search::ThreadPool threads;
     
     EngineOptions options;
     std::atomic<bool> searching;
     std::atomic<bool> quit;
     std::thread searchThread;
     
+    // bestmove is held back during infinite / ponder searches until one of these
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+    bool stopRequested;
+    bool pondering;
+    bool infiniteSearch;
+    
     /**
      * The actual search function that runs in a separate thread
      */
@@ -117,9 +145,10 @@ public:
     Protocol();
     
     /**
-     * Main UCI loop - reads commands from stdin and responds
+     * Main UCI loop - reads commands and responds (through Utils::sendLine)
+     * @param input Command stream, stdin for a GUI or a script for tests
      */
-    void run();
+    void run(std::istream& input);
 
 private:
     ChessEngine engine;
@@ -156,6 +185,11 @@ private:
      */
     void handleStop();
     
+    /**
+     * Handle the 'ponderhit' command
+     */
+    void handlePonderHit();
+    
     /**
      * Handle the 'setoption' command
      * @param input Remaining input stream after 'setoption'
@@ -174,9 +208,22 @@ private:
     
     /**
      * Handle the 'perft' command for testing
+     * perft <depth> [threads <n> [hash <mb>]] | perft suite [maxDepth] | perft verify [maxDepth]
+     * | perft tables [maxDepth]
      */
     void handlePerft(std::istringstream& input);
     
+    /**
+     * Handle the 'divide' command (perft split by root move)
+     */
+    void handleDivide(std::istringstream& input);
+    
+    /**
+     * Handle the 'bench' command
+     * bench [depth] | bench threads <maxThreads> [movetime] | bench stop [rounds] | bench eval [games] | bench batch [positions]
+     */
+    void handleBench(std::istringstream& input);
+    
     /**
      * Parse FEN and moves from position command
      */
@@ -207,6 +254,18 @@ namespace Utils {
      * Send the best move found
      */
     void sendBestMove(const Move& bestMove, const Move& ponderMove = Move());
+    
+    /**
+     * Send one line of protocol output (the newline is added) in a single
+     * locked write, so lines from the UCI and search threads never interleave
+     */
+    void sendLine(const std::string& line);
+    
+    /**
+     * Where sendLine writes, std::cout unless redirected (e.g. by a bench harness)
+     * @param output Stream to write to, it must outlive every sendLine call
+     */
+    void setOutput(std::ostream& output);
 }
 
 } // namespace UCI
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include "pieces.h"
+
+class Board;
+
+namespace Zobrist {
+
+/**
+ * Random keys, generated at compile time from a fixed seed
+ */
+struct Keys {
+    uint64_t pieces[12][64];    // [PieceType][square]
+    uint64_t castling[16];      // Indexed by the 4 castling bits of the packed info
+    uint64_t enPassant[8];      // Indexed by file
+    uint64_t side;              // XORed in when black is to move
+};
+
+constexpr uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys generateKeys() {
+    Keys keys{};
+    uint64_t state = 0x5EED0C0FFEE1234ULL;
+    
+    for (int piece = 0; piece < 12; piece++) {
+        for (int sq = 0; sq < 64; sq++) {
+            keys.pieces[piece][sq] = splitMix64(state);
+        }
+    }
+    
+    // No castling rights hashes to zero so the index can be XORed directly
+    keys.castling[0] = 0;
+    for (int i = 1; i < 16; i++) {
+        keys.castling[i] = splitMix64(state);
+    }
+    
+    for (int file = 0; file < 8; file++) {
+        keys.enPassant[file] = splitMix64(state);
+    }
+    
+    keys.side = splitMix64(state);
+    return keys;
+}
+
+inline constexpr Keys keys = generateKeys();
+
+/**
+ * Castling key for a packed info byte (bits 1-4 hold the rights)
+ */
+constexpr uint64_t castlingKey(uint8_t packedInfo) {
+    return keys.castling[(packedInfo >> 1) & 0xF];
+}
+
+/**
+ * Compute the full position key from scratch
+ */
+uint64_t computeKey(const Board& board);
+
+/**
+ * Compute the pawn structure key (pawns of both colours only) from scratch
+ */
+uint64_t computePawnKey(const Board& board);
+
+} // namespace Zobrist
@@ -0,0 +1,339 @@
+#include "batch.h"
+#include "eval.h"
+#include <cstring>
+#include <type_traits>
+
+namespace Batch {
+
+using MoveGenerator::Color;
+using MoveGenerator::WHITE;
+using MoveGenerator::BLACK;
+
+// ============================================================================
+// Positions Implementation
+// ============================================================================
+
+Positions::Positions(size_t count)
+    : count(count),
+      lanes((count + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN),
+      data(PLANES * lanes, 0),
+      packedInfo(lanes, 0) {}
+
+void Positions::set(size_t index, const Board& board) {
+    uint64_t bitboards[PLANES];
+    board.copyPositions(bitboards);
+    for (int piece = 0; piece < PLANES; piece++) {
+        plane(piece)[index] = bitboards[piece];
+    }
+    packedInfo[index] = board.getPackedInfo();
+}
+
+void Positions::get(size_t index, Board& board) const {
+    uint64_t bitboards[PLANES];
+    for (int piece = 0; piece < PLANES; piece++) {
+        bitboards[piece] = plane(piece)[index];
+    }
+    board.restorePositions(bitboards);
+    board.setPackedInfo(packedInfo[index]);
+}
+
+// ============================================================================
+// Kernel dispatch
+// ============================================================================
+
+namespace {
+    enum Op {
+        OCCUPANCY,
+        LEAPERS,
+        PUSHES,
+        MATERIAL
+    };
+
+    struct Args {
+        Positions* positions;
+        Color side;
+        uint64_t* out;
+        uint64_t* out2;
+        int* values;
+    };
+
+    // One entry point per instruction set, defined with the kernels below
+    void runScalar(Op op, const Args& args);
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2")))
+    void runAvx2(Op op, const Args& args);
+
+    __attribute__((target("avx512f")))
+    void runAvx512(Op op, const Args& args);
+#endif
+
+    void dispatch(Kernel kernel, Op op, const Args& args) {
+#if defined(__x86_64__)
+        if (kernel == AVX512) return runAvx512(op, args);
+        if (kernel == AVX2) return runAvx2(op, args);
+#endif
+        runScalar(op, args);
+    }
+
+    Kernel detectKernel() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return AVX512;
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+#endif
+        return SCALAR;
+    }
+
+    const Kernel best_kernel = detectKernel();
+}
+
+// ============================================================================
+// Worker Implementation
+// ============================================================================
+
+Worker::Worker(Positions* positions, Kernel kernel)
+    : positions(positions), kernel(Utils::isSupported(kernel) ? kernel : SCALAR) {}
+
+void Worker::updateOccupancy() {
+    dispatch(kernel, OCCUPANCY, {positions, WHITE, nullptr, nullptr, nullptr});
+}
+
+void Worker::leaperAttacks(Color side, uint64_t* out) {
+    dispatch(kernel, LEAPERS, {positions, side, out, nullptr, nullptr});
+}
+
+void Worker::pawnPushes(Color side, uint64_t* single, uint64_t* dbl) {
+    dispatch(kernel, PUSHES, {positions, side, single, dbl, nullptr});
+}
+
+void Worker::material(int* out) {
+    dispatch(kernel, MATERIAL, {positions, WHITE, nullptr, nullptr, out});
+}
+
+// ============================================================================
+// Utils Implementation
+// ============================================================================
+
+namespace Utils {
+
+Kernel bestKernel() {
+    return best_kernel;
+}
+
+bool isSupported(Kernel kernel) {
+    return kernel <= best_kernel;
+}
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+        case AVX2: return "avx2";
+        case AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+} // namespace Utils
+
+// ============================================================================
+// Set-wise formulas
+// ============================================================================
+
+namespace {
+    typedef uint64_t Raw4 __attribute__((vector_size(32)));
+    typedef uint64_t Raw8 __attribute__((vector_size(64)));
+
+    // A GCC vector of bitboards. It is wrapped in a struct because functions
+    // returning a bare wide vector change the ABI without AVX enabled, and GCC
+    // warns about every formula below (-Wpsabi). A struct holding one is
+    // returned the same way everywhere, so there is no warning to silence.
+    template<typename Raw>
+    struct Lanes {
+        Raw v;
+
+        [[gnu::always_inline]] uint64_t operator[](size_t lane) const { return v[lane]; }
+    };
+
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator&(Lanes<R> a, Lanes<R> b) { return {a.v & b.v}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator|(Lanes<R> a, Lanes<R> b) { return {a.v | b.v}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator^(Lanes<R> a, Lanes<R> b) { return {a.v ^ b.v}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator+(Lanes<R> a, Lanes<R> b) { return {a.v + b.v}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator-(Lanes<R> a, Lanes<R> b) { return {a.v - b.v}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator&(Lanes<R> a, uint64_t b) { return {a.v & b}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator*(Lanes<R> a, uint64_t b) { return {a.v * b}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator<<(Lanes<R> a, int bits) { return {a.v << bits}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator>>(Lanes<R> a, int bits) { return {a.v >> bits}; }
+    template<typename R> [[gnu::always_inline]] inline Lanes<R> operator~(Lanes<R> a) { return {~a.v}; }
+
+    using U64x4 = Lanes<Raw4>;
+    using U64x8 = Lanes<Raw8>;
+
+    // V is uint64_t (one position) or Lanes of bitboards. The vector
+    // operators compile to AVX2 / AVX-512 in the target-specific entry points
+    // below, so every formula is written once for all lane widths.
+    // Vectors are copied through their raw member: a copy into the struct
+    // itself is kept on the stack by GCC and every load bounces through it
+    template<typename V>
+    [[gnu::always_inline]] inline V load(const uint64_t* p) {
+        if constexpr (std::is_same_v<V, uint64_t>) {
+            return *p;
+        } else {
+            decltype(V::v) raw;
+            std::memcpy(&raw, p, sizeof(raw));
+            return {raw};
+        }
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline void store(uint64_t* p, const V& v) {
+        if constexpr (std::is_same_v<V, uint64_t>) {
+            *p = v;
+        } else {
+            std::memcpy(p, &v.v, sizeof(v.v));
+        }
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline V knightAttacks(const V& b) {
+        V l1 = (b >> 1) & ~FILE_H;
+        V l2 = (b >> 2) & ~(FILE_G | FILE_H);
+        V r1 = (b << 1) & ~FILE_A;
+        V r2 = (b << 2) & ~(FILE_A | FILE_B);
+        V h1 = l1 | r1;
+        V h2 = l2 | r2;
+        return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline V kingAttacks(const V& b) {
+        V row = b | ((b << 1) & ~FILE_A) | ((b >> 1) & ~FILE_H);
+        return (row | (row << 8) | (row >> 8)) ^ b;
+    }
+
+    template<Color Us, typename V>
+    [[gnu::always_inline]] inline V pawnAttacks(const V& b) {
+        if constexpr (Us == WHITE) return ((b << 7) & ~FILE_H) | ((b << 9) & ~FILE_A);
+        else return ((b >> 9) & ~FILE_H) | ((b >> 7) & ~FILE_A);
+    }
+
+    // Hardware popcount for one position, SWAR for a vector (no per-lane
+    // popcount below AVX-512 VPOPCNTDQ, and this only needs shifts and adds)
+    [[gnu::always_inline]] inline uint64_t popcount(uint64_t b) {
+        return __builtin_popcountll(b);
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline V popcount(const V& bits) {
+        V b = bits - ((bits >> 1) & 0x5555555555555555ULL);
+        b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+        b = (b + (b >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        b = b + (b >> 8);
+        b = b + (b >> 16);
+        b = b + (b >> 32);
+        return b & 0x7F;
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline V count(const Positions& pos, Color side, PieceType piece, size_t i) {
+        return popcount(load<V>(pos.plane(MoveGenerator::pieceOf(side, piece)) + i));
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline V sideMaterial(const Positions& pos, Color side, size_t i) {
+        return count<V>(pos, side, white_pawn, i) * Eval::PAWN_VALUE
+             + count<V>(pos, side, white_knight, i) * Eval::KNIGHT_VALUE
+             + count<V>(pos, side, white_bishop, i) * Eval::BISHOP_VALUE
+             + count<V>(pos, side, white_rook, i) * Eval::ROOK_VALUE
+             + count<V>(pos, side, white_queen, i) * Eval::QUEEN_VALUE;
+    }
+
+    // ========================================================================
+    // Kernels
+    // ========================================================================
+
+    template<typename V>
+    [[gnu::always_inline]] inline void occupancy(Positions& pos, size_t i) {
+        V white = load<V>(pos.plane(white_pawn) + i) | load<V>(pos.plane(white_rook) + i)
+                | load<V>(pos.plane(white_knight) + i) | load<V>(pos.plane(white_bishop) + i)
+                | load<V>(pos.plane(white_queen) + i) | load<V>(pos.plane(white_king) + i);
+        V black = load<V>(pos.plane(black_pawn) + i) | load<V>(pos.plane(black_rook) + i)
+                | load<V>(pos.plane(black_knight) + i) | load<V>(pos.plane(black_bishop) + i)
+                | load<V>(pos.plane(black_queen) + i) | load<V>(pos.plane(black_king) + i);
+        store(pos.plane(white_occ) + i, white);
+        store(pos.plane(black_occ) + i, black);
+        store(pos.plane(occ) + i, white | black);
+    }
+
+    template<Color Us, typename V>
+    [[gnu::always_inline]] inline void leapers(const Args& args, size_t i) {
+        const Positions& pos = *args.positions;
+        V pawns = load<V>(pos.plane(MoveGenerator::pieceOf(Us, white_pawn)) + i);
+        V knights = load<V>(pos.plane(MoveGenerator::pieceOf(Us, white_knight)) + i);
+        V king = load<V>(pos.plane(MoveGenerator::pieceOf(Us, white_king)) + i);
+        store(args.out + i, pawnAttacks<Us>(pawns) | knightAttacks(knights) | kingAttacks(king));
+    }
+
+    template<Color Us, typename V>
+    [[gnu::always_inline]] inline void pushes(const Args& args, size_t i) {
+        const Positions& pos = *args.positions;
+        V pawns = load<V>(pos.plane(MoveGenerator::pieceOf(Us, white_pawn)) + i);
+        V empty = ~load<V>(pos.plane(occ) + i);
+        V single, dbl;
+        if constexpr (Us == WHITE) {
+            single = (pawns << 8) & empty;
+            dbl = ((single & RANK_3) << 8) & empty;
+        } else {
+            single = (pawns >> 8) & empty;
+            dbl = ((single & RANK_6) >> 8) & empty;
+        }
+        store(args.out + i, single);
+        store(args.out2 + i, dbl);
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline void material(const Args& args, size_t i) {
+        V balance = sideMaterial<V>(*args.positions, WHITE, i) - sideMaterial<V>(*args.positions, BLACK, i);
+        if constexpr (std::is_same_v<V, uint64_t>) {
+            args.values[i] = static_cast<int>(static_cast<int64_t>(balance));
+        } else {
+            for (size_t lane = 0; lane < sizeof(V) / sizeof(uint64_t); lane++) {
+                args.values[i + lane] = static_cast<int>(static_cast<int64_t>(balance[lane]));
+            }
+        }
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] inline void run(Op op, const Args& args) {
+        constexpr size_t STEP = sizeof(V) / sizeof(uint64_t);
+        const size_t lanes = args.positions->capacity();
+
+        switch (op) {
+            case OCCUPANCY:
+                for (size_t i = 0; i < lanes; i += STEP) occupancy<V>(*args.positions, i);
+                break;
+            case LEAPERS:
+                if (args.side == WHITE) for (size_t i = 0; i < lanes; i += STEP) leapers<WHITE, V>(args, i);
+                else for (size_t i = 0; i < lanes; i += STEP) leapers<BLACK, V>(args, i);
+                break;
+            case PUSHES:
+                if (args.side == WHITE) for (size_t i = 0; i < lanes; i += STEP) pushes<WHITE, V>(args, i);
+                else for (size_t i = 0; i < lanes; i += STEP) pushes<BLACK, V>(args, i);
+                break;
+            case MATERIAL:
+                for (size_t i = 0; i < lanes; i += STEP) material<V>(args, i);
+                break;
+        }
+    }
+
+    void runScalar(Op op, const Args& args) { run<uint64_t>(op, args); }
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2")))
+    void runAvx2(Op op, const Args& args) { run<U64x4>(op, args); }
+
+    __attribute__((target("avx512f")))
+    void runAvx512(Op op, const Args& args) { run<U64x8>(op, args); }
+#endif
+}
+
+} // namespace Batch
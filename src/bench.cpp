@@ -0,0 +1,476 @@
+#include "bench.h"
+#include "batch.h"
+#include "board.h"
+#include "generator.h"
+#include "eval.h"
+#include "search.h"
+#include "thread_pool.h"
+#include "uci.h"
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <streambuf>
+#include <thread>
+#include <algorithm>
+#include <random>
+
+// ============================================================================
+// Allocation counting (bench builds only, see CHESS_COUNT_ALLOCATIONS)
+// ============================================================================
+
+#ifdef CHESS_COUNT_ALLOCATIONS
+static std::atomic<long long> allocations(0);
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+namespace Bench {
+
+const std::vector<std::string> positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/1q1nbppp/r3p3/3pP3/pPpP4/P1P3P1/2Q2PBP/R4RK1 w - - 0 20",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1"
+};
+
+long long allocationCount() {
+#ifdef CHESS_COUNT_ALLOCATIONS
+    return allocations.load(std::memory_order_relaxed);
+#else
+    return -1;
+#endif
+}
+
+void run(int depth) {
+    long long totalNodes = 0;
+    long long totalQNodes = 0;
+    long long totalAllocations = 0;
+    long long totalMs = 0;
+    double logBranching = 0;
+    
+    Search::TranspositionTable tt;
+    tt.resize(16);
+    
+    for (size_t i = 0; i < positions.size(); i++) {
+        Board board(positions[i].c_str());
+        MoveGenerator::Worker moveGen(&board);
+        Eval::Worker evaluator(&board);
+        Search::Worker searcher(&board, &moveGen, &evaluator, &tt);
+        tt.clear();
+        
+        Search::SearchLimits limits;
+        limits.maxDepth = depth;
+        
+        std::cerr << "Position " << (i + 1) << "/" << positions.size() << ": " << positions[i] << std::endl;
+        
+        long long allocationsBefore = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        
+        searcher.search(limits);
+        
+        auto end = std::chrono::steady_clock::now();
+        totalAllocations += allocationCount() - allocationsBefore;
+        totalMs += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        totalNodes += searcher.getStats().nodes + searcher.getStats().qnodes;
+        totalQNodes += searcher.getStats().qnodes;
+        
+        // Effective branching factor: main search nodes = b^depth
+        const Search::SearchStats& stats = searcher.getStats();
+        logBranching += std::log(std::max(1LL, stats.nodes)) / std::max(1, stats.depth);
+    }
+    
+    std::cerr << "\n===========================" << std::endl;
+    std::cerr << "Total time (ms) : " << totalMs << std::endl;
+    std::cerr << "Nodes searched  : " << totalNodes << std::endl;
+    std::cerr << "  in quiescence : " << totalQNodes << std::endl;
+    std::cerr << "Nodes/second    : " << (totalMs > 0 ? totalNodes * 1000 / totalMs : 0) << std::endl;
+    std::cerr << "Branching factor: " << std::fixed << std::setprecision(2)
+              << std::exp(logBranching / positions.size()) << std::defaultfloat << std::endl;
+    if (allocationCount() >= 0) {
+        std::cerr << "Allocations     : " << totalAllocations << std::endl;
+    } else {
+        std::cerr << "Allocations     : not counted (configure with -DCHESS_COUNT_ALLOCATIONS=ON)" << std::endl;
+    }
+}
+
+void runThreads(int maxThreads, int moveTime) {
+    Search::TranspositionTable tt;
+    tt.resize(64);
+    Search::ThreadPool pool(&tt);
+    long long baseNps = 0;
+    
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        pool.setThreadCount(threads);
+        tt.clear();
+        
+        long long totalNodes = 0;
+        long long totalMs = 0;
+        
+        for (const auto& fen : positions) {
+            Board board(fen.c_str());
+            Search::SearchLimits limits;
+            limits.moveTime = moveTime;
+            
+            auto start = std::chrono::steady_clock::now();
+            Search::SearchResult result = pool.search(board, limits);
+            auto end = std::chrono::steady_clock::now();
+            
+            totalNodes += result.stats.nodes + result.stats.qnodes;
+            totalMs += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        }
+        
+        long long nps = totalMs > 0 ? totalNodes * 1000 / totalMs : 0;
+        if (threads == 1) baseNps = nps;
+        
+        std::cerr << "Threads " << threads 
+                  << " : nodes " << totalNodes 
+                  << " nps " << nps 
+                  << " speedup " << (baseNps > 0 ? static_cast<double>(nps) / baseNps : 0.0) 
+                  << std::endl;
+    }
+}
+
+namespace {
+    // Lines passed between the bench and Protocol::run: reads block until a
+    // whole line is there, writes are split into lines as they arrive
+    class LinePipe : public std::streambuf {
+    public:
+        void writeLine(const std::string& line) {
+            push(line + "\n");
+        }
+        
+        std::string readLine() {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !lines.empty(); });
+            std::string line = std::move(lines.front());
+            lines.pop_front();
+            line.pop_back();
+            return line;
+        }
+        
+    protected:
+        int_type underflow() override {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]() { return !lines.empty(); });
+                current = std::move(lines.front());
+                lines.pop_front();
+            }
+            setg(current.data(), current.data(), current.data() + current.size());
+            return traits_type::to_int_type(current[0]);
+        }
+        
+        // Writers are serialized by UCI::Utils::sendLine
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+            pending += traits_type::to_char_type(c);
+            if (pending.back() == '\n') {
+                push(std::move(pending));
+                pending.clear();
+            }
+            return c;
+        }
+        
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::string> lines;
+        std::string current;
+        std::string pending;
+        
+        void push(std::string line) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                lines.push_back(std::move(line));
+            }
+            ready.notify_all();
+        }
+    };
+    
+    // Read engine output until a line starting with prefix
+    void waitFor(LinePipe& pipe, const std::string& prefix) {
+        while (pipe.readLine().rfind(prefix, 0) != 0) {}
+    }
+}
+
+void runStopLatency(int iterations) {
+    // A scripted GUI: commands go through the same Protocol::run loop as
+    // stdin, and the clock stops when the bestmove line comes out
+    LinePipe commands;
+    LinePipe replies;
+    std::istream input(&commands);
+    std::ostream output(&replies);
+    UCI::Utils::setOutput(output);
+    
+    UCI::Protocol protocol;
+    std::thread uci([&]() { protocol.run(input); });
+    
+    commands.writeLine("isready");
+    waitFor(replies, "readyok");
+    
+    std::vector<long long> latencies;
+    
+    for (int i = 0; i < iterations; i++) {
+        commands.writeLine("position fen " + positions[i % positions.size()]);
+        commands.writeLine("go infinite");
+        commands.writeLine("isready");
+        waitFor(replies, "readyok");
+        
+        // Vary the delay so stop lands at different points of the tree
+        std::this_thread::sleep_for(std::chrono::milliseconds(20 + (i * 37) % 200));
+        
+        auto start = std::chrono::steady_clock::now();
+        commands.writeLine("stop");
+        waitFor(replies, "bestmove");
+        auto end = std::chrono::steady_clock::now();
+        
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+    
+    commands.writeLine("quit");
+    uci.join();
+    UCI::Utils::setOutput(std::cout);
+    
+    if (latencies.empty()) return;
+    
+    std::sort(latencies.begin(), latencies.end());
+    long long sum = 0;
+    for (long long us : latencies) sum += us;
+    
+    std::cerr << "\n===========================" << std::endl;
+    std::cerr << "Rounds          : " << latencies.size() << std::endl;
+    std::cerr << "Stop latency us : min " << latencies.front() 
+              << " median " << latencies[latencies.size() / 2] 
+              << " avg " << sum / static_cast<long long>(latencies.size()) 
+              << " max " << latencies.back() << std::endl;
+}
+
+bool runEvalCheck(int games) {
+    constexpr int MAX_GAME_LENGTH = 300;
+    std::mt19937_64 rng(20250101);
+    long long checks = 0;
+    long long mismatches = 0;
+    
+    for (int game = 0; game < games; game++) {
+        Board board(positions[game % positions.size()].c_str());
+        MoveGenerator::Worker moveGen(&board);
+        Eval::Worker evaluator(&board);
+        
+        auto check = [&]() {
+            checks++;
+            if (evaluator.evaluate() != evaluator.evaluateWithPST()) mismatches++;
+        };
+        
+        check();
+        int plies = 0;
+        bool over = false;
+        while (!over && plies < MAX_GAME_LENGTH) {
+            // The state stack holds MAX_STACK_PLY moves: play them, take them
+            // back, then replay them and make the end the new root
+            std::vector<Move> segment;
+            while (plies < MAX_GAME_LENGTH && segment.size() < MAX_STACK_PLY) {
+                MoveList moves;
+                moveGen.generateLegalMoves(moves);
+                if (moves.empty()) {
+                    over = true;
+                    break;
+                }
+                
+                segment.push_back(moves[rng() % moves.size()].move);
+                board.makeMove(segment.back());
+                plies++;
+                check();
+            }
+            
+            for (size_t i = 0; i < segment.size(); i++) {
+                board.unmakeMove();
+                check();
+            }
+            for (const Move& move : segment) board.makeMove(move);
+            board.setRoot();
+        }
+    }
+    
+    std::cerr << "\n===========================" << std::endl;
+    std::cerr << "Games           : " << games << std::endl;
+    std::cerr << "Positions       : " << checks << std::endl;
+    std::cerr << "Mismatches      : " << mismatches << std::endl;
+    return mismatches == 0;
+}
+
+namespace {
+    using MoveGenerator::AttackTables;
+    using MoveGenerator::Color;
+    using MoveGenerator::WHITE;
+    using MoveGenerator::BLACK;
+    using MoveGenerator::pieceOf;
+    
+    // Outputs of one pass of the batch kernels, one entry per lane
+    struct BatchOutputs {
+        std::vector<uint64_t> occupancy[3];
+        std::vector<uint64_t> leapers[2];
+        std::vector<uint64_t> single[2];
+        std::vector<uint64_t> dbl[2];
+        std::vector<int> material;
+        
+        explicit BatchOutputs(size_t lanes) : material(lanes) {
+            for (auto& v : occupancy) v.resize(lanes);
+            for (int side = 0; side < 2; side++) {
+                leapers[side].resize(lanes);
+                single[side].resize(lanes);
+                dbl[side].resize(lanes);
+            }
+        }
+        
+        bool operator==(const BatchOutputs& other) const = default;
+    };
+    
+    // The same quantities the way the engine gets them from a Board:
+    // table lookups per knight and king, set-wise pawns
+    uint64_t leaperAttacks(const Board& board, Color side) {
+        uint64_t pawns = board.positions[pieceOf(side, white_pawn)];
+        uint64_t attacks = side == WHITE ? ((pawns << 7) & ~FILE_H) | ((pawns << 9) & ~FILE_A)
+                                         : ((pawns >> 9) & ~FILE_H) | ((pawns >> 7) & ~FILE_A);
+        for (uint64_t bb = board.positions[pieceOf(side, white_knight)]; bb; bb &= bb - 1) {
+            attacks |= AttackTables::getKnightAttacks(__builtin_ctzll(bb));
+        }
+        for (uint64_t bb = board.positions[pieceOf(side, white_king)]; bb; bb &= bb - 1) {
+            attacks |= AttackTables::getKingAttacks(__builtin_ctzll(bb));
+        }
+        return attacks;
+    }
+    
+    int material(const Board& board, Color side) {
+        auto count = [&](PieceType piece) { return __builtin_popcountll(board.positions[pieceOf(side, piece)]); };
+        return count(white_pawn) * Eval::PAWN_VALUE + count(white_knight) * Eval::KNIGHT_VALUE
+             + count(white_bishop) * Eval::BISHOP_VALUE + count(white_rook) * Eval::ROOK_VALUE
+             + count(white_queen) * Eval::QUEEN_VALUE;
+    }
+    
+    void boardPass(std::vector<Board>& boards, BatchOutputs& out) {
+        for (size_t i = 0; i < boards.size(); i++) {
+            Board& board = boards[i];
+            uint64_t white = 0, black = 0;
+            for (int piece = white_pawn; piece <= white_king; piece++) {
+                white |= board.positions[piece];
+                black |= board.positions[piece + 6];
+            }
+            out.occupancy[0][i] = white;
+            out.occupancy[1][i] = black;
+            out.occupancy[2][i] = white | black;
+            
+            uint64_t empty = ~(white | black);
+            for (Color side : {WHITE, BLACK}) {
+                uint64_t pawns = board.positions[pieceOf(side, white_pawn)];
+                uint64_t single = side == WHITE ? (pawns << 8) & empty : (pawns >> 8) & empty;
+                out.leapers[side][i] = leaperAttacks(board, side);
+                out.single[side][i] = single;
+                out.dbl[side][i] = side == WHITE ? ((single & RANK_3) << 8) & empty
+                                                 : ((single & RANK_6) >> 8) & empty;
+            }
+            out.material[i] = material(board, WHITE) - material(board, BLACK);
+        }
+    }
+    
+    void batchPass(Batch::Positions& batch, Batch::Worker& worker, BatchOutputs& out) {
+        worker.updateOccupancy();
+        std::copy_n(batch.plane(white_occ), batch.capacity(), out.occupancy[0].data());
+        std::copy_n(batch.plane(black_occ), batch.capacity(), out.occupancy[1].data());
+        std::copy_n(batch.plane(occ), batch.capacity(), out.occupancy[2].data());
+        for (Color side : {WHITE, BLACK}) {
+            worker.leaperAttacks(side, out.leapers[side].data());
+            worker.pawnPushes(side, out.single[side].data(), out.dbl[side].data());
+        }
+        worker.material(out.material.data());
+    }
+}
+
+bool runBatch(int count) {
+    // Enough rounds for every pass to take a measurable time
+    constexpr long long LANES_PER_PASS = 4000000;
+    constexpr int MAX_PLAYOUT = 80;
+    std::mt19937_64 rng(20250101);
+    
+    // Random positions from random playouts of the bench positions
+    std::vector<Board> boards;
+    boards.reserve(count);
+    Batch::Positions batch(count);
+    for (int i = 0; i < count; i++) {
+        Board board(positions[i % positions.size()].c_str());
+        MoveGenerator::Worker moveGen(&board);
+        int plies = rng() % MAX_PLAYOUT;
+        for (int ply = 0; ply < plies; ply++) {
+            MoveList moves;
+            moveGen.generateLegalMoves(moves);
+            if (moves.empty()) break;
+            board.makeMove(moves[rng() % moves.size()].move);
+        }
+        boards.push_back(board);
+        batch.set(i, board);
+    }
+    
+    // Board results are padded to the batch lane count with empty positions
+    int rounds = static_cast<int>(std::max<long long>(1, LANES_PER_PASS / count));
+    BatchOutputs reference(batch.capacity());
+    
+    auto time = [&](auto pass) {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) pass();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return seconds > 0 ? count * static_cast<double>(rounds) / seconds : 0.0;
+    };
+    
+    double boardRate = time([&]() { boardPass(boards, reference); });
+    std::cerr << "Positions       : " << count << " x " << rounds << " rounds" << std::endl;
+    std::cerr << "Memory          : " << sizeof(Board) << " bytes/board, "
+              << Batch::Positions::PLANES * sizeof(uint64_t) + 1 << " bytes/lane" << std::endl;
+    std::cerr << "Board loop      : " << static_cast<long long>(boardRate) << " positions/s" << std::endl;
+    
+    bool allMatch = true;
+    for (Batch::Kernel kernel : {Batch::SCALAR, Batch::AVX2, Batch::AVX512}) {
+        std::string label = std::string("Batch ") + Batch::Utils::kernelName(kernel);
+        std::cerr << std::left << std::setw(16) << label << std::right << ": ";
+        if (!Batch::Utils::isSupported(kernel)) {
+            std::cerr << "not supported" << std::endl;
+            continue;
+        }
+        
+        Batch::Worker worker(&batch, kernel);
+        BatchOutputs out(batch.capacity());
+        double rate = time([&]() { batchPass(batch, worker, out); });
+        bool match = out == reference;
+        allMatch = allMatch && match;
+        
+        std::cerr << static_cast<long long>(rate) << " positions/s, speedup "
+                  << (boardRate > 0 ? rate / boardRate : 0.0)
+                  << (match ? "" : " MISMATCH") << std::endl;
+    }
+    
+    return allMatch;
+}
+
+} // namespace Bench
@@ -1,5 +1,9 @@
 #include "board.h"
+#include "zobrist.h"
+#include "eval.h"
 #include <cstring>
+#include <cstdlib>
+#include <cassert>
 
 Board::Board() {
     std::memset(positions, 0, sizeof(positions));
@@ -25,14 +29,29 @@ Board::Board() {
     half_clock = 0U;
 
     _packed_info = 0x1F;  // White to move, all castling rights
+    _ply = 0;
+    _invalidateAttacks();
 
     _updateOccupancy();
+    _refreshPieceInfo();
+    _refreshKeys();
 }
 
 Board::Board(const char *fen) {
     std::memset(positions, 0, sizeof(positions));
     _packed_info = 0;
+    half_clock = 0U;
+    _ply = 0;
+    _invalidateAttacks();
+
+    _fenImport(fen);
+
+    _updateOccupancy();
+    _refreshPieceInfo();
+    _refreshKeys();
+}
 
+void Board::_fenImport(const char *fen) {
     char buf[256];
     std::strncpy(buf, fen, sizeof(buf) - 1);
     buf[sizeof(buf) - 1] = '\0';
@@ -77,8 +96,11 @@ Board::Board(const char *fen) {
     half_clock = std::atoi(token);
 
     // Full move counter is ignored since it doesn't help the engine
+}
 
-    _updateOccupancy();
+void Board::_refreshKeys() {
+    _key = Zobrist::computeKey(*this);
+    _pawn_key = Zobrist::computePawnKey(*this);
 }
 
 void Board::_fenImportBoard(const char* boardFen) {
@@ -128,14 +150,79 @@ bool Board::isOccupied(int square) {
 
 void Board::takePieceFrom(PieceType pieceType, int square) {
     if (square < 1 || square > 64) return;
-    positions[pieceType] &= ~(1ULL << (square - 1));
-    _updateOccupancy();
+    if (!(positions[pieceType] & (1ULL << (square - 1)))) return;
+    _key ^= Zobrist::keys.pieces[pieceType][square - 1];
+    if (pieceType == white_pawn || pieceType == black_pawn) {
+        _pawn_key ^= Zobrist::keys.pieces[pieceType][square - 1];
+    }
+    _removePiece(pieceType, square - 1);
+    _invalidateAttacks();
 }
 
 void Board::putPieceOn(PieceType pieceType, int square) {
     if (square < 1 || square > 64) return;
-    positions[pieceType] |= (1ULL << (square - 1));
-    _updateOccupancy();
+    int current = _piece_on[square - 1];
+    if (current == pieceType) return;
+    if (current != -1) takePieceFrom(static_cast<PieceType>(current), square);
+    _key ^= Zobrist::keys.pieces[pieceType][square - 1];
+    if (pieceType == white_pawn || pieceType == black_pawn) {
+        _pawn_key ^= Zobrist::keys.pieces[pieceType][square - 1];
+    }
+    _addPiece(pieceType, square - 1);
+    _invalidateAttacks();
+}
+
+// ============================================================================
+// Incremental piece updates
+// ============================================================================
+
+inline void Board::_addPiece(int pieceType, int square) {
+    uint64_t bit = 1ULL << square;
+    positions[pieceType] |= bit;
+    positions[pieceType <= white_king ? white_occ : black_occ] |= bit;
+    positions[occ] |= bit;
+    _piece_on[square] = static_cast<int8_t>(pieceType);
+    _psq_mg += Eval::Tables::psq.mg[pieceType][square];
+    _psq_eg += Eval::Tables::psq.eg[pieceType][square];
+    _phase += Eval::Tables::phase_weight[pieceType];
+}
+
+inline void Board::_removePiece(int pieceType, int square) {
+    uint64_t bit = 1ULL << square;
+    positions[pieceType] ^= bit;
+    positions[pieceType <= white_king ? white_occ : black_occ] ^= bit;
+    positions[occ] ^= bit;
+    _piece_on[square] = -1;
+    _psq_mg -= Eval::Tables::psq.mg[pieceType][square];
+    _psq_eg -= Eval::Tables::psq.eg[pieceType][square];
+    _phase -= Eval::Tables::phase_weight[pieceType];
+}
+
+inline void Board::_movePiece(int pieceType, int from, int to) {
+    uint64_t bits = (1ULL << from) | (1ULL << to);
+    positions[pieceType] ^= bits;
+    positions[pieceType <= white_king ? white_occ : black_occ] ^= bits;
+    positions[occ] ^= bits;
+    _piece_on[from] = -1;
+    _piece_on[to] = static_cast<int8_t>(pieceType);
+    _psq_mg += Eval::Tables::psq.mg[pieceType][to] - Eval::Tables::psq.mg[pieceType][from];
+    _psq_eg += Eval::Tables::psq.eg[pieceType][to] - Eval::Tables::psq.eg[pieceType][from];
+}
+
+void Board::_refreshPieceInfo() {
+    std::memset(_piece_on, -1, sizeof(_piece_on));
+    _psq_mg = _psq_eg = _phase = 0;
+    for (int piece = white_pawn; piece <= black_king; piece++) {
+        uint64_t bb = positions[piece];
+        while (bb) {
+            int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            _piece_on[sq] = static_cast<int8_t>(piece);
+            _psq_mg += Eval::Tables::psq.mg[piece][sq];
+            _psq_eg += Eval::Tables::psq.eg[piece][sq];
+            _phase += Eval::Tables::phase_weight[piece];
+        }
+    }
 }
 
 void Board::_updateOccupancy() {
@@ -182,22 +269,21 @@ bool Board::blackCanCastleQS() {
 
 int Board::getPieceAt(int square) const {
     if (square < 1 || square > 64) return -1;
-    uint64_t mask = 1ULL << (square - 1);
-    
-    // Check each piece type
-    for (int i = white_pawn; i <= black_king; i++) {
-        if (positions[i] & mask) return i;
-    }
-    return -1; // Empty square
+    return _piece_on[square - 1];
 }
 
 void Board::toogleTurn() {
     _packed_info ^= 0x1;
+    _key ^= Zobrist::keys.side;
+    
+    // Also the first write to a new ply's slot in makeMove
+    _invalidateAttacks();
 }
 
 void Board::setTurn(bool isWhite) {
     if (isWhite) _packed_info |= 1;
     else _packed_info &= ~1;
+    _invalidateAttacks();
 }
 
 void Board::setWhiteCanCastleKS(bool can) {
@@ -226,50 +312,81 @@ void Board::copyPositions(uint64_t dest[16]) const {
 
 void Board::restorePositions(const uint64_t src[16]) {
     std::memcpy(positions, src, sizeof(uint64_t) * 16);
+    _refreshPieceInfo();
+    _refreshKeys();
+    _invalidateAttacks();
 }
 
+// Castling rights that survive a move touching each square
+static constexpr uint8_t CASTLING_MASK[64] = {
+    0x1B, 0x1F, 0x1F, 0x1F, 0x19, 0x1F, 0x1F, 0x1D,  // a1 drops Q, e1 drops KQ, h1 drops K
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+    0x0F, 0x1F, 0x1F, 0x1F, 0x07, 0x1F, 0x1F, 0x17   // a8 drops q, e8 drops kq, h8 drops k
+};
+
 bool Board::makeMove(const Move& move) {
-    UndoInfo undo;
+    int from_sq = move.from();
+    int to_sq = move.to();
+    
+    // Find which piece is moving
+    int movingPieceInt = _piece_on[from_sq];
+    if (movingPieceInt == -1 || _ply >= MAX_STACK_PLY) return false;
+    
+    UndoInfo& undo = _undo_stack[_ply++];
     undo.old_en_passant = positions[en_passant];
     undo.old_packed_info = _packed_info;
+    undo.old_half_clock = half_clock;
+    undo.old_key = _key;
+    undo.old_pawn_key = _pawn_key;
     undo.move = move;
-    undo.captured_piece_type = static_cast<PieceType>(-1);
-    undo.captured_piece_bb = 0;
+    undo.captured_piece_type = -1;
     
-    int from_sq = move.from - 1;  // Convert to 0-based
-    int to_sq = move.to - 1;
-    
-    // Find which piece is moving
-    int movingPieceInt = getPieceAt(move.from);
-    if (movingPieceInt == -1) return false;
+    const auto& zobrist = Zobrist::keys;
     
     PieceType movingPiece = static_cast<PieceType>(movingPieceInt);
     bool isWhite = (movingPiece <= white_king);
     
     // Handle captures (normal capture)
-    int capturedInt = getPieceAt(move.to);
+    int capturedInt = _piece_on[to_sq];
     if (capturedInt != -1) {
-        undo.captured_piece_type = static_cast<PieceType>(capturedInt);
-        undo.captured_piece_bb = positions[capturedInt];
-        positions[capturedInt] &= ~(1ULL << to_sq);
+        undo.captured_piece_type = static_cast<int8_t>(capturedInt);
+        _removePiece(capturedInt, to_sq);
+        _key ^= zobrist.pieces[capturedInt][to_sq];
+        if (capturedInt == white_pawn || capturedInt == black_pawn) {
+            _pawn_key ^= zobrist.pieces[capturedInt][to_sq];
+        }
     }
     
     // Move the piece
-    positions[movingPiece] &= ~(1ULL << from_sq);
-    positions[movingPiece] |= (1ULL << to_sq);
+    _movePiece(movingPiece, from_sq, to_sq);
+    _key ^= zobrist.pieces[movingPiece][from_sq] ^ zobrist.pieces[movingPiece][to_sq];
+    
+    bool isPawnMove = (movingPiece == white_pawn || movingPiece == black_pawn);
+    if (isPawnMove) {
+        _pawn_key ^= zobrist.pieces[movingPiece][from_sq] ^ zobrist.pieces[movingPiece][to_sq];
+    }
     
     // Clear en passant
+    if (positions[en_passant]) {
+        _key ^= zobrist.enPassant[__builtin_ctzll(positions[en_passant]) % 8];
+    }
     positions[en_passant] = 0;
     
     // Handle special moves
-    switch (move.type) {
+    switch (move.type()) {
         case EN_PASSANT: {
             // Remove the captured pawn
             int capturedPawnSq = isWhite ? to_sq - 8 : to_sq + 8;
             PieceType capturedPawn = isWhite ? black_pawn : white_pawn;
-            undo.captured_piece_type = capturedPawn;
-            undo.captured_piece_bb = positions[capturedPawn];
-            positions[capturedPawn] &= ~(1ULL << capturedPawnSq);
+            undo.captured_piece_type = static_cast<int8_t>(capturedPawn);
+            _removePiece(capturedPawn, capturedPawnSq);
+            _key ^= zobrist.pieces[capturedPawn][capturedPawnSq];
+            _pawn_key ^= zobrist.pieces[capturedPawn][capturedPawnSq];
             break;
         }
         
@@ -288,16 +405,18 @@ bool Board::makeMove(const Move& move) {
                 rookTo = isWhite ? 3 : 59;
             }
             
-            positions[rook] &= ~(1ULL << rookFrom);
-            positions[rook] |= (1ULL << rookTo);
+            _movePiece(rook, rookFrom, rookTo);
+            _key ^= zobrist.pieces[rook][rookFrom] ^ zobrist.pieces[rook][rookTo];
             break;
         }
         
         case PROMOTION: {
-            // Remove pawn
-            positions[movingPiece] &= ~(1ULL << to_sq);
-            // Add promoted piece
-            positions[move.promotionPiece] |= (1ULL << to_sq);
+            PieceType promoted = move.promotionPiece(isWhite);
+            // Swap the pawn for the promoted piece
+            _removePiece(movingPiece, to_sq);
+            _addPiece(promoted, to_sq);
+            _key ^= zobrist.pieces[movingPiece][to_sq] ^ zobrist.pieces[promoted][to_sq];
+            _pawn_key ^= zobrist.pieces[movingPiece][to_sq];
             break;
         }
         
@@ -305,34 +424,27 @@ bool Board::makeMove(const Move& move) {
             break;
     }
     
-    // Set en passant square for double pawn push
-    if ((movingPiece == white_pawn || movingPiece == black_pawn)) {
+    // Set en passant square for double pawn push, only when an enemy pawn
+    // stands next to the pushed pawn (so the key does not depend on dead squares)
+    if (isPawnMove) {
         int rankDiff = (to_sq / 8) - (from_sq / 8);
         if (rankDiff == 2 || rankDiff == -2) {
-            int epSquare = (from_sq + to_sq) / 2;
-            positions[en_passant] = 1ULL << epSquare;
+            uint64_t pushed = 1ULL << to_sq;
+            uint64_t neighbours = ((pushed << 1) & ~FILE_A) | ((pushed >> 1) & ~FILE_H);
+            if (neighbours & positions[isWhite ? black_pawn : white_pawn]) {
+                int epSquare = (from_sq + to_sq) / 2;
+                positions[en_passant] = 1ULL << epSquare;
+                _key ^= zobrist.enPassant[epSquare % 8];
+            }
         }
     }
     
-    // Update castling rights
-    // King moves
-    if (movingPiece == white_king) {
-        setWhiteCanCastleKS(false);
-        setWhiteCanCastleQS(false);
-    }
-    if (movingPiece == black_king) {
-        setBlackCanCastleKS(false);
-        setBlackCanCastleQS(false);
-    }
-    
-    // Rook moves or is captured
-    if (from_sq == 0 || to_sq == 0) setWhiteCanCastleQS(false);
-    if (from_sq == 7 || to_sq == 7) setWhiteCanCastleKS(false);
-    if (from_sq == 56 || to_sq == 56) setBlackCanCastleQS(false);
-    if (from_sq == 63 || to_sq == 63) setBlackCanCastleKS(false);
+    // Update castling rights (king or rook moves, rook is captured)
+    _packed_info &= CASTLING_MASK[from_sq] & CASTLING_MASK[to_sq];
+    _key ^= Zobrist::castlingKey(undo.old_packed_info) ^ Zobrist::castlingKey(_packed_info);
     
     // Update half-move clock
-    if (movingPiece == white_pawn || movingPiece == black_pawn || capturedInt != -1) {
+    if (isPawnMove || undo.captured_piece_type != -1) {
         half_clock = 0;
     } else {
         half_clock++;
@@ -341,81 +453,180 @@ bool Board::makeMove(const Move& move) {
     // Toggle turn
     toogleTurn();
     
-    // Update occupancy
-    _updateOccupancy();
-    
-    _undo_stack.push_back(undo);
+#ifdef CHESS_VERIFY_STATE
+    _verifyState();
+#endif
     
     return true;
 }
 
 void Board::unmakeMove() {
-    if (_undo_stack.empty()) return;
-    
-    UndoInfo undo = _undo_stack.back();
-    _undo_stack.pop_back();
+    if (_ply == 0) return;
     
-    const Move& move = undo.move;
-    int from_sq = move.from - 1;
-    int to_sq = move.to - 1;
+    const UndoInfo& undo = _undo_stack[--_ply];
     
-    // Find which piece moved (it's now at the 'to' square)
-    int movingPieceInt = getPieceAt(move.to);
+    const Move move = undo.move;
+    int from_sq = move.from();
+    int to_sq = move.to();
+    bool wasWhiteMoving = undo.old_packed_info & 1;  // Saved before the turn was toggled
     
     // Handle promotion - the piece at 'to' is the promoted piece, not the pawn
-    if (move.type == PROMOTION) {
-        // Remove promoted piece
-        positions[move.promotionPiece] &= ~(1ULL << to_sq);
-        
-        // Restore the pawn
-        bool isWhite = (move.promotionPiece <= white_king);
-        PieceType pawn = isWhite ? white_pawn : black_pawn;
-        positions[pawn] |= (1ULL << from_sq);
-    } else if (movingPieceInt != -1) {
-        PieceType movingPiece = static_cast<PieceType>(movingPieceInt);
-        
-        // Move piece back
-        positions[movingPiece] &= ~(1ULL << to_sq);
-        positions[movingPiece] |= (1ULL << from_sq);
+    if (move.type() == PROMOTION) {
+        _removePiece(move.promotionPiece(wasWhiteMoving), to_sq);
+        _addPiece(wasWhiteMoving ? white_pawn : black_pawn, from_sq);
+    } else {
+        _movePiece(_piece_on[to_sq], to_sq, from_sq);
     }
     
     // Restore captured piece
-    if (static_cast<int>(undo.captured_piece_type) != -1) {
-        if (move.type == EN_PASSANT) {
+    if (undo.captured_piece_type != -1) {
+        if (move.type() == EN_PASSANT) {
             // En passant capture - restore pawn to its original square
-            bool wasWhiteMoving = !(undo.old_packed_info & 1);  // Turn was toggled
             int capturedPawnSq = wasWhiteMoving ? to_sq - 8 : to_sq + 8;
-            positions[undo.captured_piece_type] |= (1ULL << capturedPawnSq);
+            _addPiece(undo.captured_piece_type, capturedPawnSq);
         } else {
             // Normal capture
-            positions[undo.captured_piece_type] |= (1ULL << to_sq);
+            _addPiece(undo.captured_piece_type, to_sq);
         }
     }
     
     // Handle castling - move rook back
-    if (move.type == CASTLING) {
-        bool wasWhiteMoving = !(undo.old_packed_info & 1);
+    if (move.type() == CASTLING) {
         PieceType rook = wasWhiteMoving ? white_rook : black_rook;
         
-        int rookFrom, rookTo;
         if (to_sq > from_sq) {
             // Kingside
-            rookFrom = wasWhiteMoving ? 7 : 63;
-            rookTo = wasWhiteMoving ? 5 : 61;
+            _movePiece(rook, wasWhiteMoving ? 5 : 61, wasWhiteMoving ? 7 : 63);
         } else {
             // Queenside
-            rookFrom = wasWhiteMoving ? 0 : 56;
-            rookTo = wasWhiteMoving ? 3 : 59;
+            _movePiece(rook, wasWhiteMoving ? 3 : 59, wasWhiteMoving ? 0 : 56);
         }
-        
-        // Move rook back
-        positions[rook] &= ~(1ULL << rookTo);
-        positions[rook] |= (1ULL << rookFrom);
     }
     
     // Restore state
     positions[en_passant] = undo.old_en_passant;
     _packed_info = undo.old_packed_info;
+    half_clock = undo.old_half_clock;
+    _key = undo.old_key;
+    _pawn_key = undo.old_pawn_key;
     
-    _updateOccupancy();
+#ifdef CHESS_VERIFY_STATE
+    _verifyState();
+#endif
+}
+
+bool Board::makeNullMove() {
+    if (_ply >= MAX_STACK_PLY) return false;
+    
+    UndoInfo& undo = _undo_stack[_ply++];
+    undo.old_en_passant = positions[en_passant];
+    undo.old_packed_info = _packed_info;
+    undo.old_half_clock = half_clock;
+    undo.old_key = _key;
+    undo.old_pawn_key = _pawn_key;
+    undo.move = Move();
+    undo.captured_piece_type = -1;
+    
+    if (positions[en_passant]) {
+        _key ^= Zobrist::keys.enPassant[__builtin_ctzll(positions[en_passant]) % 8];
+        positions[en_passant] = 0;
+    }
+    
+    half_clock++;
+    toogleTurn();
+    return true;
+}
+
+void Board::unmakeNullMove() {
+    const UndoInfo& undo = _undo_stack[--_ply];
+    
+    positions[en_passant] = undo.old_en_passant;
+    _packed_info = undo.old_packed_info;
+    half_clock = undo.old_half_clock;
+    _key = undo.old_key;
+    _pawn_key = undo.old_pawn_key;
+}
+
+void Board::setRoot() {
+    if (_ply == 0) return;
+    
+    // Only positions since the last irreversible move (or null move) can come back
+    int older = _history ? static_cast<int>(_history->size()) : 0;
+    int total = older + _ply;
+    int start = total - (half_clock < total ? half_clock : total);
+    for (int i = 0; i < _ply; i++) {
+        if (_undo_stack[i].move.isNull() && older + i + 1 > start) start = older + i + 1;
+    }
+    
+    if (start < total) {
+        auto history = std::make_shared<std::vector<uint64_t>>();
+        history->reserve(total - start);
+        for (int i = start; i < total; i++) {
+            history->push_back(i < older ? (*_history)[i] : _undo_stack[i - older].old_key);
+        }
+        _history = std::move(history);
+    } else {
+        _history.reset();
+    }
+    
+    _attack_cache[0] = _attack_cache[_ply];
+    _ply = 0;
+}
+
+bool Board::isRepetition(int searchPly) const {
+    int older = _history ? static_cast<int>(_history->size()) : 0;
+    int end = half_clock < _ply + older ? half_clock : _ply + older;
+    int count = 0;
+    
+    // Same side to move only, so every second entry
+    for (int back = 2; back <= end; back += 2) {
+        uint64_t key;
+        if (back <= _ply) {
+            const UndoInfo& undo = _undo_stack[_ply - back];
+            
+            // A position before a pass cannot be reached again by real moves
+            if (undo.move.isNull() || _undo_stack[_ply - back + 1].move.isNull()) {
+                return false;
+            }
+            key = undo.old_key;
+        } else {
+            // Past the bottom of the stack (its first entry is the only one left unchecked)
+            if (back == _ply + 1 && _undo_stack[0].move.isNull()) {
+                return false;
+            }
+            key = (*_history)[older - (back - _ply)];
+        }
+        
+        if (key == _key) {
+            if (back <= searchPly || ++count == 2) {
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
+void Board::_verifyState() const {
+    assert(_key == Zobrist::computeKey(*this));
+    assert(_pawn_key == Zobrist::computePawnKey(*this));
+
+    uint64_t white = 0, black = 0;
+    int mg = 0, eg = 0, phase = 0;
+    for (int piece = white_pawn; piece <= black_king; piece++) {
+        (piece <= white_king ? white : black) |= positions[piece];
+        for (uint64_t bb = positions[piece]; bb; bb &= bb - 1) {
+            int sq = __builtin_ctzll(bb);
+            assert(_piece_on[sq] == piece);
+            mg += Eval::Tables::psq.mg[piece][sq];
+            eg += Eval::Tables::psq.eg[piece][sq];
+            phase += Eval::Tables::phase_weight[piece];
+        }
+    }
+    assert(_psq_mg == mg && _psq_eg == eg && _phase == phase);
+    assert(positions[white_occ] == white && positions[black_occ] == black);
+    assert(positions[occ] == (white | black));
+    for (int sq = 0; sq < 64; sq++) {
+        assert((_piece_on[sq] == -1) == !((white | black) & (1ULL << sq)));
+    }
 }
@@ -1,5 +1,6 @@
 #include "eval.h"
 #include "generator.h"
+#include <cassert>
 
 namespace Eval {
 
@@ -9,7 +10,7 @@ namespace Eval {
 
 namespace Tables {
     // Pawn table - encourage center control and advancement
-    const int pawn_table[64] = {
+    constexpr int pawn_table[64] = {
          0,   0,   0,   0,   0,   0,   0,   0,
         50,  50,  50,  50,  50,  50,  50,  50,
         10,  10,  20,  30,  30,  20,  10,  10,
@@ -21,7 +22,7 @@ namespace Tables {
     };
     
     // Knight table - encourage central positions
-    const int knight_table[64] = {
+    constexpr int knight_table[64] = {
         -50, -40, -30, -30, -30, -30, -40, -50,
         -40, -20,   0,   0,   0,   0, -20, -40,
         -30,   0,  10,  15,  15,  10,   0, -30,
@@ -33,7 +34,7 @@ namespace Tables {
     };
     
     // Bishop table - encourage long diagonals
-    const int bishop_table[64] = {
+    constexpr int bishop_table[64] = {
         -20, -10, -10, -10, -10, -10, -10, -20,
         -10,   0,   0,   0,   0,   0,   0, -10,
         -10,   0,   5,  10,  10,   5,   0, -10,
@@ -45,7 +46,7 @@ namespace Tables {
     };
     
     // Rook table - encourage 7th rank and open files
-    const int rook_table[64] = {
+    constexpr int rook_table[64] = {
          0,   0,   0,   0,   0,   0,   0,   0,
          5,  10,  10,  10,  10,  10,  10,   5,
         -5,   0,   0,   0,   0,   0,   0,  -5,
@@ -57,7 +58,7 @@ namespace Tables {
     };
     
     // Queen table - slight center preference
-    const int queen_table[64] = {
+    constexpr int queen_table[64] = {
         -20, -10, -10,  -5,  -5, -10, -10, -20,
         -10,   0,   0,   0,   0,   0,   0, -10,
         -10,   0,   5,   5,   5,   5,   0, -10,
@@ -69,7 +70,7 @@ namespace Tables {
     };
     
     // King middlegame table - encourage castling and safety
-    const int king_middlegame_table[64] = {
+    constexpr int king_middlegame_table[64] = {
         -30, -40, -40, -50, -50, -40, -40, -30,
         -30, -40, -40, -50, -50, -40, -40, -30,
         -30, -40, -40, -50, -50, -40, -40, -30,
@@ -81,7 +82,7 @@ namespace Tables {
     };
     
     // King endgame table - encourage centralization
-    const int king_endgame_table[64] = {
+    constexpr int king_endgame_table[64] = {
         -50, -40, -30, -20, -20, -30, -40, -50,
         -30, -20, -10,   0,   0, -10, -20, -30,
         -30, -10,  20,  30,  30,  20, -10, -30,
@@ -91,6 +92,35 @@ namespace Tables {
         -30, -30,   0,   0,   0,   0, -30, -30,
         -50, -30, -30, -30, -30, -30, -30, -50
     };
+    
+    constexpr int phase_weight[12] = {
+        0, 2, 1, 1, 4, 0,  // pawn, rook, knight, bishop, queen, king
+        0, 2, 1, 1, 4, 0
+    };
+    
+    constexpr PSQTable buildPSQ() {
+        constexpr const int* tables[6] = {
+            pawn_table, rook_table, knight_table, bishop_table, queen_table, king_middlegame_table
+        };
+        constexpr int values[6] = {
+            PAWN_VALUE, ROOK_VALUE, KNIGHT_VALUE, BISHOP_VALUE, QUEEN_VALUE, 0
+        };
+        
+        PSQTable table{};
+        for (int piece = white_pawn; piece <= white_king; piece++) {
+            const int* endgameTable = piece == white_king ? king_endgame_table : tables[piece];
+            for (int sq = 0; sq < 64; sq++) {
+                int mirrored = (7 - sq / 8) * 8 + sq % 8;
+                table.mg[piece][sq] = values[piece] + tables[piece][sq];
+                table.eg[piece][sq] = values[piece] + endgameTable[sq];
+                table.mg[piece + 6][sq] = -(values[piece] + tables[piece][mirrored]);
+                table.eg[piece + 6][sq] = -(values[piece] + endgameTable[mirrored]);
+            }
+        }
+        return table;
+    }
+    
+    constexpr PSQTable psq = buildPSQ();
 }
 
 // ============================================================================
@@ -100,16 +130,16 @@ namespace Tables {
 Worker::Worker(Board* board) : board(board) {}
 
 int Worker::evaluate() {
-    int score = 0;
+    int score = Utils::taper(board->getPsqMg(), board->getPsqEg(), board->getPhase());
     
-    // Material score
-    score += getMaterialScore();
+    // Return from current side's perspective
+    score = board->isWhiteTurn() ? score : -score;
     
-    // Piece-square tables
-    score += getPieceSquareScore();
+#ifdef CHESS_VERIFY_STATE
+    assert(score == evaluateWithPST());
+#endif
     
-    // Return from current side's perspective
-    return board->isWhiteTurn() ? score : -score;
+    return score;
 }
 
 int Worker::evaluateMaterial() {
@@ -118,10 +148,21 @@ int Worker::evaluateMaterial() {
 }
 
 int Worker::evaluateWithPST() {
-    int score = getMaterialScore() + getPieceSquareScore();
+    int material = getMaterialScore();
+    int mg = material + getPieceSquareScore(false);
+    int eg = material + getPieceSquareScore(true);
+    int score = Utils::taper(mg, eg, getGamePhase());
     return board->isWhiteTurn() ? score : -score;
 }
 
+int Worker::getGamePhase() {
+    int phase = 0;
+    for (int pieceType = white_pawn; pieceType <= black_king; pieceType++) {
+        phase += __builtin_popcountll(board->positions[pieceType]) * Tables::phase_weight[pieceType];
+    }
+    return phase;
+}
+
 int Worker::getMaterialScore() {
     int score = 0;
     
@@ -142,7 +183,7 @@ int Worker::getMaterialScore() {
     return score;
 }
 
-int Worker::getPieceSquareScore() {
+int Worker::getPieceSquareScore(bool endgame) {
     int score = 0;
     
     // White pieces
@@ -152,7 +193,7 @@ int Worker::getPieceSquareScore() {
             int square = __builtin_ctzll(pieces);
             pieces &= pieces - 1; // Remove LSB
             
-            score += getPSTValue(static_cast<PieceType>(pieceType), square);
+            score += getPSTValue(static_cast<PieceType>(pieceType), square, endgame);
         }
     }
     
@@ -164,16 +205,14 @@ int Worker::getPieceSquareScore() {
             pieces &= pieces - 1; // Remove LSB
             
             int mirroredSquare = Utils::mirrorSquare(square);
-            score -= getPSTValue(static_cast<PieceType>(pieceType - 6), mirroredSquare);
+            score -= getPSTValue(static_cast<PieceType>(pieceType - 6), mirroredSquare, endgame);
         }
     }
     
     return score;
 }
 
-int Worker::getPSTValue(PieceType piece, int square) {
-    bool endgame = isEndgame();
-    
+int Worker::getPSTValue(PieceType piece, int square, bool endgame) {
     switch (piece) {
         case white_pawn:
             return Tables::pawn_table[square];
@@ -1,87 +1,56 @@
 #include "generator.h"
+#include "eval.h"
 #include <cstring>
 
 namespace MoveGenerator {
 
 // ============================================================================
-// AttackTables Implementation
+// Magic numbers (fixed shift: 64 - number of relevant blocker bits)
 // ============================================================================
 
-uint64_t AttackTables::knight_attacks[64];
-uint64_t AttackTables::king_attacks[64];
-uint64_t AttackTables::white_pawn_attacks[64];
-uint64_t AttackTables::black_pawn_attacks[64];
-bool AttackTables::initialized = false;
+static constexpr uint64_t ROOK_MAGICS[64] = {
+    0x0280132180004001ULL, 0x0140001000200040ULL, 0x0880200010000880ULL, 0x2080080005801000ULL,
+    0x0200041020080200ULL, 0x0200041041084200ULL, 0x0400080081124410ULL, 0x2180042100004080ULL,
+    0x8000800099644000ULL, 0x0802003040820100ULL, 0x0105801001862000ULL, 0x0101002008100100ULL,
+    0x1000800400080080ULL, 0x0804800200040080ULL, 0x2001800200800900ULL, 0x00160004088204C1ULL,
+    0x228000C001402000ULL, 0x8510004000200050ULL, 0x3001848020029000ULL, 0x0280808010000801ULL,
+    0x0109010010040800ULL, 0x8000808004000200ULL, 0x8000040081021028ULL, 0x40040A0009004884ULL,
+    0x80C0004280008035ULL, 0x0010004040002000ULL, 0x1101200500410070ULL, 0x8410100080080080ULL,
+    0x000C080080800400ULL, 0x4012008080040002ULL, 0x4000040101000200ULL, 0x0061010200008044ULL,
+    0x0080804010800020ULL, 0x3000201008400040ULL, 0x4112008012002444ULL, 0x0848000880801000ULL,
+    0x00A8008008800400ULL, 0x200200280A00500CULL, 0x080A221024004801ULL, 0xC400008042000104ULL,
+    0x8000400080028022ULL, 0x0220008040018020ULL, 0x4000200011010040ULL, 0x10060040210A0010ULL,
+    0x40820020904A0004ULL, 0x0030040002008080ULL, 0x0200020801840010ULL, 0x0084C04100820004ULL,
+    0x4802010080C2A600ULL, 0x0000400080201880ULL, 0x2040801000200080ULL, 0x0180200842001200ULL,
+    0x0013510008000500ULL, 0x0182000C00808A80ULL, 0x1000524821302400ULL, 0x3800040108488200ULL,
+    0x104A004810210082ULL, 0x0004210010420082ULL, 0xC424110008200241ULL, 0x90101000A0088501ULL,
+    0x0182000420100802ULL, 0x4822001001080402ULL, 0x05D0080090012204ULL, 0x2008140089042846ULL
+};
+
+static constexpr uint64_t BISHOP_MAGICS[64] = {
+    0x0420220228022C80ULL, 0x200208010C108000ULL, 0x1004010411040040ULL, 0x12A4040292002440ULL,
+    0x0804042082000850ULL, 0x0802020220010440ULL, 0x800401048260201AULL, 0x0041010800828800ULL,
+    0x4040641488080104ULL, 0x20002004016E0020ULL, 0x0C2C223A12420042ULL, 0x0100024081020220ULL,
+    0x0383211041025080ULL, 0x08C0030420160600ULL, 0x0C1000510808C00AULL, 0x40501A0084140280ULL,
+    0x40280040112C0088ULL, 0x4020040908110050ULL, 0x1028001008801412ULL, 0x0104220202020000ULL,
+    0x800A000400940010ULL, 0x0401000200512410ULL, 0x1082012100900408ULL, 0x0101402208440C00ULL,
+    0x00482104C01C1111ULL, 0x0310105008017101ULL, 0x0022010108080020ULL, 0x02300400104010A0ULL,
+    0x1401010011444000ULL, 0x1001020000405020ULL, 0x00010A0804480411ULL, 0x0419220010404400ULL,
+    0x0010020A00200820ULL, 0xA008280909040104ULL, 0x0210209010080020ULL, 0x3006110800040040ULL,
+    0x0800820200440090ULL, 0x0008100421810080ULL, 0x0028060093264800ULL, 0x0A08004088810080ULL,
+    0x3611100290442000ULL, 0x0241081282001001ULL, 0x11081108010D0800ULL, 0x002A102014420800ULL,
+    0x480002600A004500ULL, 0x8001010102000100ULL, 0x2008080810410883ULL, 0x0002080901101022ULL,
+    0x2800942420444080ULL, 0x2000840108024000ULL, 0x0000804844100040ULL, 0x1444120020884540ULL,
+    0x0004001002020C00ULL, 0x041041C801010049ULL, 0x0060045000850810ULL, 0x1003240C14820208ULL,
+    0x3010104A10100800ULL, 0x0280020101580200ULL, 0x1000000101081600ULL, 0x0644009800420200ULL,
+    0x0050040008102402ULL, 0x00000004601C8106ULL, 0x00088530040812A0ULL, 0x800218010102020CULL
+};
 
-void AttackTables::initialize() {
-    if (initialized) return;
-    
-    // Knight moves (L-shape: 2 squares in one direction, 1 in perpendicular)
-    for (int sq = 0; sq < 64; sq++) {
-        uint64_t attacks = 0ULL;
-        int rank = sq / 8;
-        int file = sq % 8;
-        
-        int knight_moves[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
-        for (auto& move : knight_moves) {
-            int new_rank = rank + move[0];
-            int new_file = file + move[1];
-            if (new_rank >= 0 && new_rank < 8 && new_file >= 0 && new_file < 8) {
-                attacks |= (1ULL << (new_rank * 8 + new_file));
-            }
-        }
-        knight_attacks[sq] = attacks;
-    }
-    
-    // King moves (one square in any direction)
-    for (int sq = 0; sq < 64; sq++) {
-        uint64_t attacks = 0ULL;
-        int rank = sq / 8;
-        int file = sq % 8;
-        
-        for (int dr = -1; dr <= 1; dr++) {
-            for (int df = -1; df <= 1; df++) {
-                if (dr == 0 && df == 0) continue;
-                int new_rank = rank + dr;
-                int new_file = file + df;
-                if (new_rank >= 0 && new_rank < 8 && new_file >= 0 && new_file < 8) {
-                    attacks |= (1ULL << (new_rank * 8 + new_file));
-                }
-            }
-        }
-        king_attacks[sq] = attacks;
-    }
-    
-    // White pawn attacks (diagonal forward)
-    for (int sq = 0; sq < 64; sq++) {
-        uint64_t attacks = 0ULL;
-        int rank = sq / 8;
-        int file = sq % 8;
-        
-        if (rank < 7) {
-            if (file > 0) attacks |= (1ULL << (sq + 7)); // Capture left
-            if (file < 7) attacks |= (1ULL << (sq + 9)); // Capture right
-        }
-        white_pawn_attacks[sq] = attacks;
-    }
-    
-    // Black pawn attacks (diagonal backward)
-    for (int sq = 0; sq < 64; sq++) {
-        uint64_t attacks = 0ULL;
-        int rank = sq / 8;
-        int file = sq % 8;
-        
-        if (rank > 0) {
-            if (file > 0) attacks |= (1ULL << (sq - 9)); // Capture left
-            if (file < 7) attacks |= (1ULL << (sq - 7)); // Capture right
-        }
-        black_pawn_attacks[sq] = attacks;
-    }
-    
-    initialized = true;
-}
+// ============================================================================
+// Compile-time table generation
+// ============================================================================
 
-uint64_t AttackTables::computeRookAttacks(int square, uint64_t blockers) {
+static constexpr uint64_t computeRookAttacks(int square, uint64_t blockers) {
     uint64_t attacks = 0ULL;
     int rank = square / 8;
     int file = square % 8;
@@ -114,7 +83,7 @@ uint64_t AttackTables::computeRookAttacks(int square, uint64_t blockers) {
     return attacks;
 }
 
-uint64_t AttackTables::computeBishopAttacks(int square, uint64_t blockers) {
+static constexpr uint64_t computeBishopAttacks(int square, uint64_t blockers) {
     uint64_t attacks = 0ULL;
     int rank = square / 8;
     int file = square % 8;
@@ -147,32 +116,215 @@ uint64_t AttackTables::computeBishopAttacks(int square, uint64_t blockers) {
     return attacks;
 }
 
-uint64_t AttackTables::getRookAttacks(int square, uint64_t occupancy) {
-    return computeRookAttacks(square, occupancy);
+/**
+ * Every square reached by one of the (rank, file) steps, clipped to the board
+ */
+template<int N>
+static constexpr std::array<uint64_t, 64> leaperTable(const int (&steps)[N][2]) {
+    std::array<uint64_t, 64> table{};
+    for (int sq = 0; sq < 64; sq++) {
+        int rank = sq / 8;
+        int file = sq % 8;
+        for (const auto& step : steps) {
+            int new_rank = rank + step[0];
+            int new_file = file + step[1];
+            if (new_rank >= 0 && new_rank < 8 && new_file >= 0 && new_file < 8) {
+                table[sq] |= (1ULL << (new_rank * 8 + new_file));
+            }
+        }
+    }
+    return table;
 }
 
-uint64_t AttackTables::getBishopAttacks(int square, uint64_t occupancy) {
-    return computeBishopAttacks(square, occupancy);
+static constexpr int KNIGHT_STEPS[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
+static constexpr int KING_STEPS[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
+static constexpr int WHITE_PAWN_STEPS[2][2] = {{1,-1},{1,1}};
+static constexpr int BLACK_PAWN_STEPS[2][2] = {{-1,-1},{-1,1}};
+
+/**
+ * Lines (between = false) or segments (between = true) through aligned squares
+ */
+static constexpr std::array<std::array<uint64_t, 64>, 64> alignedTable(bool between) {
+    std::array<std::array<uint64_t, 64>, 64> table{};
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            if (a == b) continue;
+            
+            uint64_t pair = (1ULL << a) | (1ULL << b);
+            auto compute = (computeRookAttacks(a, 0) & (1ULL << b)) ? computeRookAttacks :
+                           (computeBishopAttacks(a, 0) & (1ULL << b)) ? computeBishopAttacks : nullptr;
+            if (!compute) continue;
+            
+            table[a][b] = between ? compute(a, 1ULL << b) & compute(b, 1ULL << a)
+                                  : (compute(a, 0) & compute(b, 0)) | pair;
+        }
+    }
+    return table;
+}
+
+static constexpr int popCount(uint64_t bb) {
+    int count = 0;
+    for (; bb; bb &= bb - 1) count++;
+    return count;
+}
+
+/**
+ * Software PEXT, only used to lay out the PEXT tables at compile time
+ */
+static constexpr unsigned pextIndex(uint64_t occupancy, uint64_t mask) {
+    unsigned result = 0;
+    for (unsigned bit = 1; mask; mask &= mask - 1, bit <<= 1) {
+        if (occupancy & mask & -mask) result |= bit;
+    }
+    return result;
+}
+
+static constexpr std::array<AttackTables::Magic, 64> magicTable(const uint64_t (&numbers)[64], bool rook) {
+    std::array<AttackTables::Magic, 64> magics{};
+    unsigned offset = 0;
+    
+    for (int sq = 0; sq < 64; sq++) {
+        int rank = sq / 8;
+        int file = sq % 8;
+        
+        // A blocker on the board edge cannot hide anything behind it, so edge
+        // squares are dropped from the mask (except along a rook's own rank/file)
+        uint64_t edges = RANK_1 | RANK_8 | FILE_A | FILE_H;
+        if (rook) {
+            edges = ((RANK_1 | RANK_8) & ~(static_cast<uint64_t>(RANK_1) << (8 * rank))) |
+                    ((FILE_A | FILE_H) & ~(FILE_A << file));
+        }
+        
+        AttackTables::Magic& m = magics[sq];
+        m.mask = (rook ? computeRookAttacks(sq, 0) : computeBishopAttacks(sq, 0)) & ~edges;
+        m.magic = numbers[sq];
+        m.shift = 64 - popCount(m.mask);
+        m.offset = offset;
+        offset += 1U << popCount(m.mask);
+    }
+    return magics;
+}
+
+/**
+ * Fill every square's slice, indexed by magic hash or by PEXT
+ */
+template<size_t Size>
+static constexpr std::array<uint64_t, Size> sliderTable(const std::array<AttackTables::Magic, 64>& magics,
+                                                        bool rook, bool pext) {
+    std::array<uint64_t, Size> table{};
+    
+    for (int sq = 0; sq < 64; sq++) {
+        const AttackTables::Magic& m = magics[sq];
+        
+        // Enumerate every subset of the mask (Carry-Rippler)
+        uint64_t subset = 0;
+        do {
+            unsigned index = pext ? pextIndex(subset, m.mask)
+                                  : static_cast<unsigned>((subset * m.magic) >> m.shift);
+            table[m.offset + index] = rook ? computeRookAttacks(sq, subset)
+                                           : computeBishopAttacks(sq, subset);
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+    }
+    return table;
+}
+
+// ============================================================================
+// AttackTables Implementation
+// ============================================================================
+
+constinit const AttackTables::Table AttackTables::knight_attacks = leaperTable(KNIGHT_STEPS);
+constinit const AttackTables::Table AttackTables::king_attacks = leaperTable(KING_STEPS);
+constinit const AttackTables::Table AttackTables::white_pawn_attacks = leaperTable(WHITE_PAWN_STEPS);
+constinit const AttackTables::Table AttackTables::black_pawn_attacks = leaperTable(BLACK_PAWN_STEPS);
+constinit const AttackTables::PairTable AttackTables::between_bb = alignedTable(true);
+constinit const AttackTables::PairTable AttackTables::line_bb = alignedTable(false);
+
+static constexpr auto ROOK_ENTRIES = magicTable(ROOK_MAGICS, true);
+static constexpr auto BISHOP_ENTRIES = magicTable(BISHOP_MAGICS, false);
+
+constinit const std::array<AttackTables::Magic, 64> AttackTables::rook_magics = ROOK_ENTRIES;
+constinit const std::array<AttackTables::Magic, 64> AttackTables::bishop_magics = BISHOP_ENTRIES;
+
+static_assert(ROOK_ENTRIES[63].offset + (1U << (64 - ROOK_ENTRIES[63].shift)) == AttackTables::ROOK_TABLE_SIZE &&
+              BISHOP_ENTRIES[63].offset + (1U << (64 - BISHOP_ENTRIES[63].shift)) == AttackTables::BISHOP_TABLE_SIZE,
+              "Slider tables hold 2^bits entries per square");
+
+constinit const std::array<uint64_t, AttackTables::ROOK_TABLE_SIZE> AttackTables::rook_table =
+    sliderTable<ROOK_TABLE_SIZE>(ROOK_ENTRIES, true, false);
+constinit const std::array<uint64_t, AttackTables::ROOK_TABLE_SIZE> AttackTables::rook_pext_table =
+    sliderTable<ROOK_TABLE_SIZE>(ROOK_ENTRIES, true, true);
+constinit const std::array<uint64_t, AttackTables::BISHOP_TABLE_SIZE> AttackTables::bishop_table =
+    sliderTable<BISHOP_TABLE_SIZE>(BISHOP_ENTRIES, false, false);
+constinit const std::array<uint64_t, AttackTables::BISHOP_TABLE_SIZE> AttackTables::bishop_pext_table =
+    sliderTable<BISHOP_TABLE_SIZE>(BISHOP_ENTRIES, false, true);
+
+static bool hasPext() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
 }
 
-uint64_t AttackTables::getQueenAttacks(int square, uint64_t occupancy) {
-    return getRookAttacks(square, occupancy) | getBishopAttacks(square, occupancy);
+/**
+ * PEXT is microcoded on AMD before Zen 3 and slower than a multiply there
+ */
+static SliderLookup fastestLookup() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (!hasPext()) return LOOKUP_MAGIC;
+    if (__builtin_cpu_is("znver1") || __builtin_cpu_is("znver2")) return LOOKUP_MAGIC;
+    return LOOKUP_PEXT;
+#else
+    return LOOKUP_MAGIC;
+#endif
 }
 
-uint64_t AttackTables::getKnightAttacks(int square) {
-    return knight_attacks[square];
+std::atomic<SliderLookup> AttackTables::lookup(fastestLookup());
+
+bool AttackTables::isSupported(SliderLookup mode) {
+    return mode != LOOKUP_PEXT || hasPext();
 }
 
-uint64_t AttackTables::getKingAttacks(int square) {
-    return king_attacks[square];
+bool AttackTables::setLookup(SliderLookup mode) {
+    if (!isSupported(mode)) return false;
+    lookup.store(mode, std::memory_order_relaxed);
+    return true;
 }
 
-uint64_t AttackTables::getWhitePawnAttacks(int square) {
-    return white_pawn_attacks[square];
+uint64_t AttackTables::rookRays(int square, uint64_t occupancy) {
+    return computeRookAttacks(square, occupancy);
 }
 
-uint64_t AttackTables::getBlackPawnAttacks(int square) {
-    return black_pawn_attacks[square];
+uint64_t AttackTables::bishopRays(int square, uint64_t occupancy) {
+    return computeBishopAttacks(square, occupancy);
+}
+
+int AttackTables::verify() {
+    bool withPext = isSupported(LOOKUP_PEXT);
+    int mismatches = 0;
+    
+    for (int sq = 0; sq < 64; sq++) {
+        for (bool rook : {true, false}) {
+            const Magic& m = rook ? rook_magics[sq] : bishop_magics[sq];
+            const uint64_t* magicTable = rook ? rook_table.data() : bishop_table.data();
+            const uint64_t* pextTable = rook ? rook_pext_table.data() : bishop_pext_table.data();
+            
+            // Every subset of the mask (carry-rippler), alone and with the rest of the board full
+            uint64_t subset = 0;
+            do {
+                for (uint64_t occupancy : {subset, subset | ~m.mask}) {
+                    uint64_t rays = rook ? computeRookAttacks(sq, occupancy) : computeBishopAttacks(sq, occupancy);
+                    if (magicTable[m.offset + (((occupancy & m.mask) * m.magic) >> m.shift)] != rays) mismatches++;
+                    if (withPext && pextTable[m.offset + pext(occupancy, m.mask)] != rays) mismatches++;
+                }
+                subset = (subset - m.mask) & m.mask;
+            } while (subset);
+        }
+    }
+    
+    return mismatches;
 }
 
 // ============================================================================
@@ -208,272 +360,327 @@ namespace Utils {
 // Worker Implementation
 // ============================================================================
 
-Worker::Worker(Board* board) : board(board) {
-    AttackTables::initialize();
+Worker::Worker(Board* board) : board(board) {}
+
+void Worker::generateAllMoves(MoveList& moves) {
+    if (board->isWhiteTurn()) generateMoves<WHITE, GEN_ALL>(moves, nullptr);
+    else generateMoves<BLACK, GEN_ALL>(moves, nullptr);
 }
 
-std::vector<Move> Worker::generateAllMoves() {
-    std::vector<Move> moves;
-    moves.reserve(128); // Average branching factor
-    
-    generatePawnMoves(moves);
-    generateKnightMoves(moves);
-    generateBishopMoves(moves);
-    generateRookMoves(moves);
-    generateQueenMoves(moves);
-    generateKingMoves(moves);
-    generateCastlingMoves(moves);
-    
-    return moves;
+void Worker::generateCaptures(MoveList& moves) {
+    if (board->isWhiteTurn()) generateMoves<WHITE, GEN_CAPTURES>(moves, nullptr);
+    else generateMoves<BLACK, GEN_CAPTURES>(moves, nullptr);
 }
 
-std::vector<Move> Worker::generateCaptures() {
-    std::vector<Move> moves;
-    moves.reserve(32);
-    
-    generatePawnMoves(moves, true);
-    generateKnightMoves(moves, true);
-    generateBishopMoves(moves, true);
-    generateRookMoves(moves, true);
-    generateQueenMoves(moves, true);
-    generateKingMoves(moves, true);
+void Worker::generateLegalMoves(MoveList& moves) {
+    if (board->isWhiteTurn()) generateLegal<WHITE, GEN_ALL>(moves);
+    else generateLegal<BLACK, GEN_ALL>(moves);
+}
+
+void Worker::generateLegalCaptures(MoveList& moves) {
+    if (board->isWhiteTurn()) generateLegal<WHITE, GEN_CAPTURES>(moves);
+    else generateLegal<BLACK, GEN_CAPTURES>(moves);
+}
+
+void Worker::generateLegalQuiets(MoveList& moves) {
+    if (board->isWhiteTurn()) generateLegal<WHITE, GEN_QUIETS>(moves);
+    else generateLegal<BLACK, GEN_QUIETS>(moves);
+}
+
+CheckInfo Worker::computeCheckInfo() {
+    return board->isWhiteTurn() ? computeCheckInfo<WHITE>() : computeCheckInfo<BLACK>();
+}
+
+template<Color Us, GenType Type>
+void Worker::generateLegal(MoveList& moves) {
+    CheckInfo info = computeCheckInfo<Us>();
     
-    return moves;
+    if (Type == GEN_ALL && info.checkers) {
+        generateMoves<Us, GEN_EVASIONS>(moves, &info);
+    } else {
+        generateMoves<Us, Type>(moves, &info);
+    }
 }
 
-void Worker::generatePawnMoves(std::vector<Move>& moves, bool capturesOnly) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t pawns = isWhite ? board->positions[white_pawn] : board->positions[black_pawn];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
-    uint64_t empty = ~board->positions[occ];
-    int direction = isWhite ? 8 : -8;
-    int startRank = isWhite ? 1 : 6;
-    int promoRank = isWhite ? 7 : 0;
+template<Color Us>
+CheckInfo Worker::computeCheckInfo() {
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
     
-    while (pawns) {
-        int from = Utils::popLSB(pawns);
-        int rank = Utils::getRank(from);
-        
-        // Single push
-        if (!capturesOnly) {
-            int to = from + direction;
-            if (to >= 0 && to < 64 && (empty & (1ULL << to))) {
-                int toRank = Utils::getRank(to);
-                if (toRank == promoRank) {
-                    addPawnPromotions(moves, from, to, false);
-                } else {
-                    moves.push_back(Move(from + 1, to + 1, 
-                        squareToAlgebraic(from) + squareToAlgebraic(to)));
-                }
-                
-                // Double push
-                if (rank == startRank) {
-                    int doubleTo = from + 2 * direction;
-                    if (empty & (1ULL << doubleTo)) {
-                        moves.push_back(Move(from + 1, doubleTo + 1, 
-                            squareToAlgebraic(from) + squareToAlgebraic(doubleTo)));
-                    }
-                }
-            }
-        }
-        
-        // Captures
-        uint64_t attacks = isWhite ? 
-            AttackTables::getWhitePawnAttacks(from) : 
-            AttackTables::getBlackPawnAttacks(from);
-        uint64_t captures = attacks & enemyPieces;
-        
-        while (captures) {
-            int to = Utils::popLSB(captures);
-            int toRank = Utils::getRank(to);
-            if (toRank == promoRank) {
-                addPawnPromotions(moves, from, to, true);
-            } else {
-                Move m(from + 1, to + 1, squareToAlgebraic(from) + "x" + squareToAlgebraic(to), CAPTURE);
-                moves.push_back(m);
-            }
-        }
-        
-        // En passant
-        if (board->positions[en_passant]) {
-            bool canEnPassant = (isWhite && rank == 4) || (!isWhite && rank == 3);
-            if (canEnPassant) {
-                uint64_t enPassantSquare = board->positions[en_passant];
-                if (attacks & enPassantSquare) {
-                    int to = Utils::getLSB(enPassantSquare);
-                    Move m(from + 1, to + 1, 
-                        squareToAlgebraic(from) + "x" + squareToAlgebraic(to) + "e.p.", EN_PASSANT);
-                    moves.push_back(m);
-                }
-            }
+    CheckInfo info;
+    uint64_t occupied = board->positions[occ];
+    uint64_t friendlyPieces = board->positions[Us == WHITE ? white_occ : black_occ];
+    
+    info.kingSquare = Utils::getLSB(board->positions[pieceOf(Us, white_king)]);
+    info.checkers = checkers();
+    info.pinned = 0;
+    
+    // Enemy sliders lined up with the king behind exactly one own piece pin it
+    uint64_t enemyQueens = board->positions[pieceOf(Them, white_queen)];
+    uint64_t enemyRooks = board->positions[pieceOf(Them, white_rook)] | enemyQueens;
+    uint64_t enemyBishops = board->positions[pieceOf(Them, white_bishop)] | enemyQueens;
+    uint64_t snipers = (AttackTables::getRookAttacks(info.kingSquare, 0) & enemyRooks) |
+                       (AttackTables::getBishopAttacks(info.kingSquare, 0) & enemyBishops);
+    
+    while (snipers) {
+        int sniper = Utils::popLSB(snipers);
+        uint64_t blockers = AttackTables::getBetween(info.kingSquare, sniper) & occupied;
+        if (blockers && !(blockers & (blockers - 1))) {
+            info.pinned |= blockers & friendlyPieces;
         }
     }
+    
+    if (info.checkers) {
+        int checker = Utils::getLSB(info.checkers);
+        info.checkMask = AttackTables::getBetween(info.kingSquare, checker) | info.checkers;
+    } else {
+        info.checkMask = ~0ULL;
+    }
+    
+    return info;
 }
 
-void Worker::generateKnightMoves(std::vector<Move>& moves, bool capturesOnly) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t knights = isWhite ? board->positions[white_knight] : board->positions[black_knight];
-    uint64_t friendlyPieces = isWhite ? board->positions[white_occ] : board->positions[black_occ];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
-    
-    while (knights) {
-        int from = Utils::popLSB(knights);
-        uint64_t attacks = AttackTables::getKnightAttacks(from);
-        uint64_t targets = capturesOnly ? (attacks & enemyPieces) : (attacks & ~friendlyPieces);
-        
-        addMovesFromBitboard(moves, from, targets, "N");
-    }
+uint64_t Worker::attackersTo(int square, uint64_t occupancy) {
+    uint64_t rooks = board->positions[white_rook] | board->positions[black_rook] |
+                     board->positions[white_queen] | board->positions[black_queen];
+    uint64_t bishops = board->positions[white_bishop] | board->positions[black_bishop] |
+                       board->positions[white_queen] | board->positions[black_queen];
+    
+    return (AttackTables::getBlackPawnAttacks(square) & board->positions[white_pawn]) |
+           (AttackTables::getWhitePawnAttacks(square) & board->positions[black_pawn]) |
+           (AttackTables::getKnightAttacks(square) & (board->positions[white_knight] | board->positions[black_knight])) |
+           (AttackTables::getKingAttacks(square) & (board->positions[white_king] | board->positions[black_king])) |
+           (AttackTables::getRookAttacks(square, occupancy) & rooks) |
+           (AttackTables::getBishopAttacks(square, occupancy) & bishops);
 }
 
-void Worker::generateBishopMoves(std::vector<Move>& moves, bool capturesOnly) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t bishops = isWhite ? board->positions[white_bishop] : board->positions[black_bishop];
-    uint64_t friendlyPieces = isWhite ? board->positions[white_occ] : board->positions[black_occ];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
-    
-    while (bishops) {
-        int from = Utils::popLSB(bishops);
-        uint64_t attacks = AttackTables::getBishopAttacks(from, board->positions[occ]);
-        uint64_t targets = capturesOnly ? (attacks & enemyPieces) : (attacks & ~friendlyPieces);
-        
-        addMovesFromBitboard(moves, from, targets, "B");
+uint64_t Worker::legalTargets(int from, uint64_t targets, const CheckInfo* info) {
+    if (!info) return targets;
+    targets &= info->checkMask;
+    if (info->pinned & (1ULL << from)) {
+        // A pinned piece may only slide along the pin ray
+        targets &= AttackTables::getLine(info->kingSquare, from);
     }
+    return targets;
 }
 
-void Worker::generateRookMoves(std::vector<Move>& moves, bool capturesOnly) {
+bool Worker::isEnPassantLegal(int from, int to) {
+    // Both pawns leave their rank at once, which can uncover a slider on the
+    // king (a horizontal pin no pin mask sees), so test the resulting position
     bool isWhite = board->isWhiteTurn();
-    uint64_t rooks = isWhite ? board->positions[white_rook] : board->positions[black_rook];
-    uint64_t friendlyPieces = isWhite ? board->positions[white_occ] : board->positions[black_occ];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
-    
-    while (rooks) {
-        int from = Utils::popLSB(rooks);
-        uint64_t attacks = AttackTables::getRookAttacks(from, board->positions[occ]);
-        uint64_t targets = capturesOnly ? (attacks & enemyPieces) : (attacks & ~friendlyPieces);
-        
-        addMovesFromBitboard(moves, from, targets, "R");
-    }
+    int capturedSquare = isWhite ? to - 8 : to + 8;
+    int kingSquare = Utils::getLSB(board->positions[isWhite ? white_king : black_king]);
+    uint64_t occupied = (board->positions[occ] ^ (1ULL << from) ^ (1ULL << capturedSquare)) | (1ULL << to);
+    uint64_t enemyPieces = (isWhite ? board->positions[black_occ] : board->positions[white_occ]) & 
+                           ~(1ULL << capturedSquare);
+    
+    return !(attackersTo(kingSquare, occupied) & enemyPieces);
 }
 
-void Worker::generateQueenMoves(std::vector<Move>& moves, bool capturesOnly) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t queens = isWhite ? board->positions[white_queen] : board->positions[black_queen];
-    uint64_t friendlyPieces = isWhite ? board->positions[white_occ] : board->positions[black_occ];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
-    
-    while (queens) {
-        int from = Utils::popLSB(queens);
-        uint64_t attacks = AttackTables::getQueenAttacks(from, board->positions[occ]);
-        uint64_t targets = capturesOnly ? (attacks & enemyPieces) : (attacks & ~friendlyPieces);
-        
-        addMovesFromBitboard(moves, from, targets, "Q");
+template<Color Us, GenType Type>
+void Worker::generateMoves(MoveList& moves, const CheckInfo* info) {
+    constexpr GenType Targets = Type == GEN_EVASIONS ? GEN_ALL : Type;
+    
+    uint64_t friendlyPieces = board->positions[Us == WHITE ? white_occ : black_occ];
+    uint64_t enemyPieces = board->positions[Us == WHITE ? black_occ : white_occ];
+    uint64_t targets = Targets == GEN_CAPTURES ? enemyPieces :
+                       Targets == GEN_QUIETS   ? ~board->positions[occ] :
+                                                 ~friendlyPieces;
+    
+    // Against two checkers only the king can move
+    bool doubleCheck = info && (info->checkers & (info->checkers - 1));
+    if (!doubleCheck) {
+        generatePawnMoves<Us, Targets>(moves, info);
+        generatePieceMoves<Us, white_knight>(moves, targets, info);
+        generatePieceMoves<Us, white_bishop>(moves, targets, info);
+        generatePieceMoves<Us, white_rook>(moves, targets, info);
+        generatePieceMoves<Us, white_queen>(moves, targets, info);
+    }
+    generateKingMoves<Us>(moves, targets, info);
+    
+    if constexpr (Type == GEN_ALL || Type == GEN_QUIETS) {
+        if (!info || !info->checkers) generateCastlingMoves<Us>(moves);
     }
 }
 
-void Worker::generateKingMoves(std::vector<Move>& moves, bool capturesOnly) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t king = isWhite ? board->positions[white_king] : board->positions[black_king];
-    uint64_t friendlyPieces = isWhite ? board->positions[white_occ] : board->positions[black_occ];
-    uint64_t enemyPieces = isWhite ? board->positions[black_occ] : board->positions[white_occ];
+/**
+ * Shift a whole bitboard one step in a direction (positive = towards rank 8)
+ */
+template<int Delta>
+static constexpr uint64_t shift(uint64_t bb) {
+    return Delta > 0 ? bb << Delta : bb >> -Delta;
+}
+
+template<Color Us, GenType Type>
+void Worker::generatePawnMoves(MoveList& moves, const CheckInfo* info) {
+    constexpr int Up = Us == WHITE ? 8 : -8;
+    constexpr int UpLeft = Us == WHITE ? 7 : -9;   // Towards the a-file
+    constexpr int UpRight = Us == WHITE ? 9 : -7;  // Towards the h-file
+    constexpr uint64_t DoublePushRank = Us == WHITE ? RANK_3 : RANK_6;  // After the first step
+    constexpr uint64_t PromotingRank = Us == WHITE ? RANK_7 : RANK_2;
+    
+    uint64_t pawns = board->positions[pieceOf(Us, white_pawn)];
+    uint64_t promoting = pawns & PromotingRank;
+    uint64_t others = pawns & ~PromotingRank;
+    uint64_t empty = ~board->positions[occ];
+    uint64_t enemyPieces = board->positions[Us == WHITE ? black_occ : white_occ];
+    uint64_t checkMask = info ? info->checkMask : ~0ULL;
     
-    if (king) {
-        int from = Utils::getLSB(king);
-        uint64_t attacks = AttackTables::getKingAttacks(from);
-        uint64_t targets = capturesOnly ? (attacks & enemyPieces) : (attacks & ~friendlyPieces);
+    // Pushes
+    if constexpr (Type != GEN_CAPTURES) {
+        uint64_t single = shift<Up>(others) & empty;
+        uint64_t doubles = shift<Up>(single & DoublePushRank) & empty;
         
-        addMovesFromBitboard(moves, from, targets, "K");
+        addPawnMoves<Up>(moves, single & checkMask, info, false);
+        addPawnMoves<2 * Up>(moves, doubles & checkMask, info, false);
     }
-}
-
-void Worker::generateCastlingMoves(std::vector<Move>& moves) {
-    bool isWhite = board->isWhiteTurn();
-    uint64_t occupied = board->positions[occ];
     
-    if (isWhite) {
-        // Kingside castling
-        if (board->whiteCanCastleKS()) {
-            if (!(occupied & ((1ULL << 5) | (1ULL << 6)))) { // f1, g1 empty
-                if (!isSquareAttacked(4, false) && !isSquareAttacked(5, false) && 
-                    !isSquareAttacked(6, false)) {
-                    Move m(5, 7, "O-O", CASTLING);  // e1 to g1
-                    moves.push_back(m);
-                }
-            }
-        }
-        // Queenside castling
-        if (board->whiteCanCastleQS()) {
-            if (!(occupied & ((1ULL << 1) | (1ULL << 2) | (1ULL << 3)))) { // b1, c1, d1 empty
-                if (!isSquareAttacked(4, false) && !isSquareAttacked(3, false) && 
-                    !isSquareAttacked(2, false)) {
-                    Move m(5, 3, "O-O-O", CASTLING);  // e1 to c1
-                    moves.push_back(m);
-                }
-            }
-        }
-    } else {
-        // Kingside castling
-        if (board->blackCanCastleKS()) {
-            if (!(occupied & ((1ULL << 61) | (1ULL << 62)))) { // f8, g8 empty
-                if (!isSquareAttacked(60, true) && !isSquareAttacked(61, true) && 
-                    !isSquareAttacked(62, true)) {
-                    Move m(61, 63, "O-O", CASTLING);  // e8 to g8
-                    moves.push_back(m);
-                }
-            }
-        }
-        // Queenside castling
-        if (board->blackCanCastleQS()) {
-            if (!(occupied & ((1ULL << 57) | (1ULL << 58) | (1ULL << 59)))) { // b8, c8, d8 empty
-                if (!isSquareAttacked(60, true) && !isSquareAttacked(59, true) && 
-                    !isSquareAttacked(58, true)) {
-                    Move m(61, 59, "O-O-O", CASTLING);  // e8 to c8
-                    moves.push_back(m);
+    // Push promotions: queening goes with the captures, underpromotions with the quiets
+    addPawnMoves<Up, Type>(moves, shift<Up>(promoting) & empty & checkMask, info, true);
+    
+    // Captures, capture promotions and en passant
+    if constexpr (Type != GEN_QUIETS) {
+        uint64_t targets = enemyPieces & checkMask;
+        
+        addPawnMoves<UpLeft>(moves, shift<UpLeft>(others & ~FILE_A) & targets, info, false);
+        addPawnMoves<UpRight>(moves, shift<UpRight>(others & ~FILE_H) & targets, info, false);
+        addPawnMoves<UpLeft>(moves, shift<UpLeft>(promoting & ~FILE_A) & targets, info, true);
+        addPawnMoves<UpRight>(moves, shift<UpRight>(promoting & ~FILE_H) & targets, info, true);
+        
+        // Checked on its own, the captured pawn is not on the target square
+        if (board->positions[en_passant]) {
+            int to = Utils::getLSB(board->positions[en_passant]);
+            uint64_t capturers = others & (Us == WHITE ? 
+                AttackTables::getBlackPawnAttacks(to) : 
+                AttackTables::getWhitePawnAttacks(to));
+            
+            while (capturers) {
+                int from = Utils::popLSB(capturers);
+                if (!info || isEnPassantLegal(from, to)) {
+                    moves.push_back(Move(from, to, EN_PASSANT));
                 }
             }
         }
     }
 }
 
-void Worker::addMovesFromBitboard(std::vector<Move>& moves, int from, uint64_t targets, 
-                                   const std::string& pieceSymbol) {
-    uint64_t enemyOcc = board->isWhiteTurn() ? board->positions[black_occ] : board->positions[white_occ];
+template<int Delta, GenType Type>
+void Worker::addPawnMoves(MoveList& moves, uint64_t targets, const CheckInfo* info, bool promotion) {
+    uint64_t pinned = info ? info->pinned : 0;
     
     while (targets) {
         int to = Utils::popLSB(targets);
-        bool isCapture = (enemyOcc & (1ULL << to)) != 0;
-        std::string notation = pieceSymbol + squareToAlgebraic(from) + 
-                               (isCapture ? "x" : "") + squareToAlgebraic(to);
-        Move m(from + 1, to + 1, notation, isCapture ? CAPTURE : NORMAL);
-        moves.push_back(m);
+        int from = to - Delta;
+        
+        // A pinned pawn may only move along the pin ray
+        if ((pinned & (1ULL << from)) && !(AttackTables::getLine(info->kingSquare, from) & (1ULL << to))) {
+            continue;
+        }
+        
+        if (promotion) {
+            addPawnPromotions<Type>(moves, from, to);
+        } else {
+            moves.push_back(Move(from, to));
+        }
     }
 }
 
-void Worker::addPawnPromotions(std::vector<Move>& moves, int from, int to, bool isCapture) {
-    std::string base = squareToAlgebraic(from) + (isCapture ? "x" : "") + squareToAlgebraic(to);
-    bool isWhite = board->isWhiteTurn();
+template<Color Us, PieceType Piece>
+void Worker::generatePieceMoves(MoveList& moves, uint64_t targets, const CheckInfo* info) {
+    uint64_t pieces = board->positions[pieceOf(Us, Piece)];
+    uint64_t occupied = board->positions[occ];
+    
+    while (pieces) {
+        int from = Utils::popLSB(pieces);
+        uint64_t attacks;
+        if constexpr (Piece == white_knight) attacks = AttackTables::getKnightAttacks(from);
+        else if constexpr (Piece == white_bishop) attacks = AttackTables::getBishopAttacks(from, occupied);
+        else if constexpr (Piece == white_rook) attacks = AttackTables::getRookAttacks(from, occupied);
+        else attacks = AttackTables::getQueenAttacks(from, occupied);
+        
+        addMovesFromBitboard(moves, from, legalTargets(from, attacks & targets, info));
+    }
+}
+
+template<Color Us>
+void Worker::generateKingMoves(MoveList& moves, uint64_t targets, const CheckInfo* info) {
+    uint64_t king = board->positions[pieceOf(Us, white_king)];
+    if (!king) return;
+    
+    int from = Utils::getLSB(king);
+    targets &= AttackTables::getKingAttacks(from);
+    
+    if (info && targets) {
+        constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+        if (hasAttackMap(Them)) {
+            // The enemy map already looks through our king, so it also covers
+            // stepping back along the line of a check
+            targets &= ~attackedBy(Them);
+        } else {
+            // A handful of squares is cheaper to test one by one than building
+            // the map; look through the king here too
+            uint64_t enemyPieces = board->positions[Us == WHITE ? black_occ : white_occ];
+            uint64_t occupied = board->positions[occ] ^ king;
+            uint64_t safe = 0;
+            while (targets) {
+                int to = Utils::popLSB(targets);
+                if (!(attackersTo(to, occupied) & enemyPieces)) safe |= 1ULL << to;
+            }
+            targets = safe;
+        }
+    }
     
-    Move queenPromo(from + 1, to + 1, base + "=Q", PROMOTION);
-    queenPromo.promotionPiece = isWhite ? white_queen : black_queen;
-    moves.push_back(queenPromo);
+    addMovesFromBitboard(moves, from, targets);
+}
+
+// Squares that must be empty / unattacked for each castle, relative to the king
+static constexpr uint64_t KS_EMPTY = 0x60ULL;       // f, g
+static constexpr uint64_t KS_SAFE = 0x70ULL;        // e, f, g
+static constexpr uint64_t QS_EMPTY = 0x0EULL;       // b, c, d
+static constexpr uint64_t QS_SAFE = 0x1CULL;        // c, d, e
+
+template<Color Us>
+void Worker::generateCastlingMoves(MoveList& moves) {
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int King = Us == WHITE ? 4 : 60;
+    constexpr int Rank = Us == WHITE ? 0 : 56;
+    uint64_t occupied = board->positions[occ];
     
-    Move rookPromo(from + 1, to + 1, base + "=R", PROMOTION);
-    rookPromo.promotionPiece = isWhite ? white_rook : black_rook;
-    moves.push_back(rookPromo);
+    // The attack map is only looked at once the path is known to be empty
+    bool kingside = (Us == WHITE ? board->whiteCanCastleKS() : board->blackCanCastleKS()) &&
+                    !(occupied & (KS_EMPTY << Rank));
+    bool queenside = (Us == WHITE ? board->whiteCanCastleQS() : board->blackCanCastleQS()) &&
+                     !(occupied & (QS_EMPTY << Rank));
+    if (!kingside && !queenside) return;
     
-    Move bishopPromo(from + 1, to + 1, base + "=B", PROMOTION);
-    bishopPromo.promotionPiece = isWhite ? white_bishop : black_bishop;
-    moves.push_back(bishopPromo);
+    uint64_t attacked = attackedBy(Them);
     
-    Move knightPromo(from + 1, to + 1, base + "=N", PROMOTION);
-    knightPromo.promotionPiece = isWhite ? white_knight : black_knight;
-    moves.push_back(knightPromo);
+    // Kingside castling: f and g empty, e, f and g not attacked
+    if (kingside && !(attacked & (KS_SAFE << Rank))) {
+        moves.push_back(Move(King, King + 2, CASTLING));
+    }
+    // Queenside castling: b, c and d empty, e, d and c not attacked
+    if (queenside && !(attacked & (QS_SAFE << Rank))) {
+        moves.push_back(Move(King, King - 2, CASTLING));
+    }
+}
+
+void Worker::addMovesFromBitboard(MoveList& moves, int from, uint64_t targets) {
+    while (targets) {
+        int to = Utils::popLSB(targets);
+        moves.push_back(Move(from, to));
+    }
 }
 
-std::string Worker::squareToAlgebraic(int square) {
-    if (square < 0 || square >= 64) return "??";
-    char file = 'a' + (square % 8);
-    char rank = '1' + (square / 8);
-    return std::string() + file + rank;
+template<GenType Type>
+void Worker::addPawnPromotions(MoveList& moves, int from, int to) {
+    if constexpr (Type != GEN_QUIETS) {
+        moves.push_back(Move(from, to, PROMOTION, white_queen));
+    }
+    if constexpr (Type != GEN_CAPTURES) {
+        moves.push_back(Move(from, to, PROMOTION, white_rook));
+        moves.push_back(Move(from, to, PROMOTION, white_bishop));
+        moves.push_back(Move(from, to, PROMOTION, white_knight));
+    }
 }
 
 bool Worker::isSquareAttacked(int square, bool byWhite) {
@@ -510,18 +717,138 @@ bool Worker::isSquareAttacked(int square, bool byWhite) {
 }
 
 bool Worker::isInCheck() {
+    // Stops at the first attacker unless checkers() already ran for this position
+    AttackInfo& cache = board->attackCache();
+    if (cache.valid & ATTACKS_CHECKERS) return cache.checkers != 0;
+    
     bool isWhite = board->isWhiteTurn();
     uint64_t king = isWhite ? board->positions[white_king] : board->positions[black_king];
     if (!king) return false;
+    return isSquareAttacked(Utils::getLSB(king), !isWhite);
+}
+
+uint64_t Worker::checkers() {
+    AttackInfo& cache = board->attackCache();
+    if (!(cache.valid & ATTACKS_CHECKERS)) {
+        bool isWhite = board->isWhiteTurn();
+        uint64_t king = board->positions[isWhite ? white_king : black_king];
+        uint64_t enemyPieces = board->positions[isWhite ? black_occ : white_occ];
+        cache.checkers = king ? attackersTo(Utils::getLSB(king), board->positions[occ]) & enemyPieces : 0;
+        cache.valid |= ATTACKS_CHECKERS;
+    }
+    return cache.checkers;
+}
+
+bool Worker::hasAttackMap(Color side) {
+    return board->attackCache().valid & (side == WHITE ? ATTACKS_WHITE : ATTACKS_BLACK);
+}
+
+uint64_t Worker::attackedBy(Color side) {
+    AttackInfo& cache = board->attackCache();
+    uint8_t flag = side == WHITE ? ATTACKS_WHITE : ATTACKS_BLACK;
+    if (!(cache.valid & flag)) {
+        cache.attacked[side] = side == WHITE ? computeAttacks<WHITE>() : computeAttacks<BLACK>();
+        cache.valid |= flag;
+    }
+    return cache.attacked[side];
+}
+
+template<Color Us>
+uint64_t Worker::computeAttacks() {
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int UpLeft = Us == WHITE ? 7 : -9;
+    constexpr int UpRight = Us == WHITE ? 9 : -7;
+    
+    // Without the enemy king a square behind it on a checking line counts as attacked
+    uint64_t occupied = board->positions[occ] ^ board->positions[pieceOf(Them, white_king)];
+    uint64_t pawns = board->positions[pieceOf(Us, white_pawn)];
+    uint64_t queens = board->positions[pieceOf(Us, white_queen)];
+    uint64_t knights = board->positions[pieceOf(Us, white_knight)];
+    uint64_t bishops = board->positions[pieceOf(Us, white_bishop)] | queens;
+    uint64_t rooks = board->positions[pieceOf(Us, white_rook)] | queens;
+    uint64_t king = board->positions[pieceOf(Us, white_king)];
+    
+    uint64_t attacks = shift<UpLeft>(pawns & ~FILE_A) | shift<UpRight>(pawns & ~FILE_H);
+    while (knights) attacks |= AttackTables::getKnightAttacks(Utils::popLSB(knights));
+    while (bishops) attacks |= AttackTables::getBishopAttacks(Utils::popLSB(bishops), occupied);
+    while (rooks) attacks |= AttackTables::getRookAttacks(Utils::popLSB(rooks), occupied);
+    if (king) attacks |= AttackTables::getKingAttacks(Utils::getLSB(king));
     
-    int kingSquare = Utils::getLSB(king);
-    return isSquareAttacked(kingSquare, !isWhite);
+    return attacks;
+}
+
+bool Worker::isPseudoLegal(const Move& move) {
+    return board->isWhiteTurn() ? isPseudoLegal<WHITE>(move) : isPseudoLegal<BLACK>(move);
 }
 
+template<Color Us>
 bool Worker::isPseudoLegal(const Move& move) {
-    std::vector<Move> allMoves = generateAllMoves();
-    for (const auto& m : allMoves) {
-        if (m.from == move.from && m.to == move.to) return true;
+    constexpr int Up = Us == WHITE ? 8 : -8;
+    constexpr uint64_t StartRank = Us == WHITE ? RANK_2 : RANK_7;
+    constexpr uint64_t LastRank = Us == WHITE ? RANK_8 : RANK_1;
+    
+    int from = move.from();
+    int to = move.to();
+    int piece = board->pieceOn(from);
+    if (piece < pieceOf(Us, white_pawn) || piece > pieceOf(Us, white_king)) return false;
+    
+    uint64_t toBB = 1ULL << to;
+    uint64_t occupied = board->positions[occ];
+    uint64_t enemyPieces = board->positions[Us == WHITE ? black_occ : white_occ];
+    if (board->positions[Us == WHITE ? white_occ : black_occ] & toBB) return false;
+    
+    // Only promotions carry a promotion piece (a stale or corrupt hash move may not)
+    if (move.type() != PROMOTION && (move.data >> 14)) return false;
+    
+    if (move.type() == CASTLING) return isCastlingPseudoLegal<Us>(from, to);
+    
+    uint64_t pawnAttacks = Us == WHITE ? AttackTables::getWhitePawnAttacks(from)
+                                       : AttackTables::getBlackPawnAttacks(from);
+    
+    if (piece == pieceOf(Us, white_pawn)) {
+        if (move.type() == EN_PASSANT) {
+            return board->positions[en_passant] == toBB && (pawnAttacks & toBB);
+        }
+        
+        // Reaching the last rank has to promote, and only there
+        if ((move.type() == PROMOTION) != static_cast<bool>(toBB & LastRank)) return false;
+        
+        if (pawnAttacks & enemyPieces & toBB) return true;
+        if (to == from + Up) return !(occupied & toBB);
+        return to == from + 2 * Up && (StartRank & (1ULL << from)) &&
+               !(occupied & (toBB | (1ULL << (from + Up))));
+    }
+    
+    if (move.type() != NORMAL) return false;
+    
+    uint64_t attacks;
+    switch (piece - pieceOf(Us, white_pawn)) {
+        case white_knight: attacks = AttackTables::getKnightAttacks(from); break;
+        case white_bishop: attacks = AttackTables::getBishopAttacks(from, occupied); break;
+        case white_rook: attacks = AttackTables::getRookAttacks(from, occupied); break;
+        case white_queen: attacks = AttackTables::getQueenAttacks(from, occupied); break;
+        default: attacks = AttackTables::getKingAttacks(from); break;
+    }
+    return attacks & toBB;
+}
+
+template<Color Us>
+bool Worker::isCastlingPseudoLegal(int from, int to) {
+    // Same conditions as generateCastlingMoves
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int King = Us == WHITE ? 4 : 60;
+    constexpr int Rank = Us == WHITE ? 0 : 56;
+    uint64_t occupied = board->positions[occ];
+    
+    if (from != King || board->pieceOn(from) != pieceOf(Us, white_king)) return false;
+    
+    if (to == King + 2) {
+        return (Us == WHITE ? board->whiteCanCastleKS() : board->blackCanCastleKS()) &&
+               !(occupied & (KS_EMPTY << Rank)) && !(attackedBy(Them) & (KS_SAFE << Rank));
+    }
+    if (to == King - 2) {
+        return (Us == WHITE ? board->whiteCanCastleQS() : board->blackCanCastleQS()) &&
+               !(occupied & (QS_EMPTY << Rank)) && !(attackedBy(Them) & (QS_SAFE << Rank));
     }
     return false;
 }
@@ -529,26 +856,132 @@ bool Worker::isPseudoLegal(const Move& move) {
 bool Worker::isLegal(const Move& move) {
     if (!isPseudoLegal(move)) return false;
     
-    // Make the move
-    if (!board->makeMove(move)) return false;
+    // Castling already tested every square the king crosses
+    if (move.type() == CASTLING) return true;
+    if (move.type() == EN_PASSANT) return isEnPassantLegal(move.from(), move.to());
+    
+    bool isWhite = board->isWhiteTurn();
+    uint64_t king = board->positions[isWhite ? white_king : black_king];
+    if (!king) return true;
+    
+    uint64_t fromBB = 1ULL << move.from();
+    uint64_t toBB = 1ULL << move.to();
+    if ((king & fromBB) && hasAttackMap(isWhite ? BLACK : WHITE)) {
+        return !(attackedBy(isWhite ? BLACK : WHITE) & toBB);
+    }
+    
+    // Pins and checks in one test: once the piece has moved, no enemy piece
+    // may reach the king (a captured piece no longer counts)
+    int kingSquare = (king & fromBB) ? move.to() : Utils::getLSB(king);
+    uint64_t occupied = (board->positions[occ] ^ fromBB) | toBB;
+    uint64_t enemyPieces = board->positions[isWhite ? black_occ : white_occ] & ~toBB;
+    
+    return !(attackersTo(kingSquare, occupied) & enemyPieces);
+}
+
+// Exchange values by PieceType (white and black)
+static constexpr int SEE_VALUE[12] = {
+    Eval::PAWN_VALUE, Eval::ROOK_VALUE, Eval::KNIGHT_VALUE, Eval::BISHOP_VALUE, Eval::QUEEN_VALUE, Eval::KING_VALUE,
+    Eval::PAWN_VALUE, Eval::ROOK_VALUE, Eval::KNIGHT_VALUE, Eval::BISHOP_VALUE, Eval::QUEEN_VALUE, Eval::KING_VALUE
+};
+
+bool Worker::seeGE(const Move& move, int threshold) {
+    if (move.type() == CASTLING) return threshold <= 0;
+    
+    int from = move.from();
+    int to = move.to();
+    int attacker = board->pieceOn(from);
+    bool isWhite = attacker < black_pawn;
+    uint64_t occupied = board->positions[occ] ^ (1ULL << from);
+    
+    // What the first capture wins, and what is left on the square to lose
+    int gain = 0;
+    int onSquare = SEE_VALUE[attacker];
+    if (move.type() == EN_PASSANT) {
+        gain = Eval::PAWN_VALUE;
+        occupied ^= 1ULL << (isWhite ? to - 8 : to + 8);
+    } else if (board->pieceOn(to) != -1) {
+        gain = SEE_VALUE[board->pieceOn(to)];
+    }
+    if (move.type() == PROMOTION) {
+        onSquare = SEE_VALUE[move.promotionPiece(isWhite)];
+        gain += onSquare - Eval::PAWN_VALUE;
+    }
     
-    // Check if the move leaves the king in check
-    // Note: After makeMove, it's the opponent's turn, so we check if our king is attacked
-    board->toogleTurn();  // Toggle back to check our king
-    bool legal = !isInCheck();
-    board->toogleTurn();  // Toggle back to opponent's turn
+    // swap is the balance for the side that just captured, assuming the other
+    // side recaptures; each side stops as soon as going on cannot help it
+    int swap = gain - threshold;
+    if (swap < 0) return false;
+    swap = onSquare - swap;
+    if (swap <= 0) return true;
+    
+    // Nobody can recapture on a square the cached map says is unattacked,
+    // unless the move uncovers a slider lined up behind the moving piece
+    if (move.type() != EN_PASSANT && hasAttackMap(isWhite ? BLACK : WHITE) &&
+        !(attackedBy(isWhite ? BLACK : WHITE) & (1ULL << to))) {
+        uint64_t theirSliders = board->positions[isWhite ? black_bishop : white_bishop] |
+                                board->positions[isWhite ? black_rook : white_rook] |
+                                board->positions[isWhite ? black_queen : white_queen];
+        if (!(AttackTables::getLine(from, to) & theirSliders)) return true;
+    }
     
-    // Unmake the move
-    board->unmakeMove();
+    uint64_t bishops = board->positions[white_bishop] | board->positions[black_bishop] |
+                       board->positions[white_queen] | board->positions[black_queen];
+    uint64_t rooks = board->positions[white_rook] | board->positions[black_rook] |
+                     board->positions[white_queen] | board->positions[black_queen];
+    uint64_t attackers = attackersTo(to, occupied);
+    bool whiteToCapture = isWhite;
+    bool result = true;
+    
+    // Least valuable first
+    static constexpr PieceType ORDER[6] = {
+        white_pawn, white_knight, white_bishop, white_rook, white_queen, white_king
+    };
+    
+    while (true) {
+        whiteToCapture = !whiteToCapture;
+        attackers &= occupied;
+        
+        uint64_t sideAttackers = attackers & board->positions[whiteToCapture ? white_occ : black_occ];
+        if (!sideAttackers) break;
+        
+        int piece = 0;
+        uint64_t candidates = 0;
+        for (PieceType type : ORDER) {
+            piece = type + (whiteToCapture ? 0 : 6);
+            candidates = sideAttackers & board->positions[piece];
+            if (candidates) break;
+        }
+        
+        // The king may only take last
+        if (piece % 6 == white_king) {
+            return (attackers & ~board->positions[whiteToCapture ? white_occ : black_occ]) ? result : !result;
+        }
+        
+        result = !result;
+        swap = SEE_VALUE[piece] - swap;
+        if (swap < static_cast<int>(result)) break;
+        
+        occupied ^= candidates & -candidates;
+        
+        // X-rays: a slider lined up behind the piece that just captured
+        if (piece % 6 == white_pawn || piece % 6 == white_bishop || piece % 6 == white_queen) {
+            attackers |= AttackTables::getBishopAttacks(to, occupied) & bishops;
+        }
+        if (piece % 6 == white_rook || piece % 6 == white_queen) {
+            attackers |= AttackTables::getRookAttacks(to, occupied) & rooks;
+        }
+    }
     
-    return legal;
+    return result;
 }
 
-std::vector<Move> Worker::filterLegalMoves(const std::vector<Move>& pseudoMoves) {
-    std::vector<Move> legalMoves;
-    legalMoves.reserve(pseudoMoves.size());
+void Worker::filterLegalMoves(MoveList& moves) {
+    int legalCount = 0;
     
-    for (const auto& move : pseudoMoves) {
+    for (int i = 0; i < moves.size(); i++) {
+        const Move move = moves[i].move;
+        
         // Make the move
         if (!board->makeMove(move)) continue;
         
@@ -561,11 +994,11 @@ std::vector<Move> Worker::filterLegalMoves(const std::vector<Move>& pseudoMoves)
         board->unmakeMove();
         
         if (legal) {
-            legalMoves.push_back(move);
+            moves[legalCount++] = moves[i];
         }
     }
     
-    return legalMoves;
+    moves.resize(legalCount);
 }
 
 } // namespace MoveGenerator
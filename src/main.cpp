@@ -7,7 +7,7 @@ int main() {
     std::cin.setf(std::ios::unitbuf);
     
     UCI::Protocol uci;
-    uci.run();
+    uci.run(std::cin);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "movepick.h"
+#include <utility>
+
+namespace Search {
+
+// ============================================================================
+// MVV-LVA (Most Valuable Victim - Least Valuable Attacker) scores
+// ============================================================================
+static const int MVV_LVA[7][7] = {
+    {0,  0,  0,  0,  0,  0,  0},
+    {0, 15, 25, 35, 45, 55, 0},
+    {0, 14, 24, 34, 44, 54, 0},
+    {0, 13, 23, 33, 43, 53, 0},
+    {0, 12, 22, 32, 42, 52, 0},
+    {0, 11, 21, 31, 41, 51, 0},
+    {0, 10, 20, 30, 40, 50, 0}
+};
+
+// Bad captures are pushed below every good capture (MVV-LVA scores stay under 10000)
+static constexpr int BAD_CAPTURE_PENALTY = 10000;
+
+// Queening is worth about a queen capture by a pawn, on top of what it captures
+static constexpr int QUEEN_PROMOTION_BONUS = 4000;
+
+static int getPieceIndex(int piece) {
+    switch (piece) {
+        case white_pawn: case black_pawn: return 1;
+        case white_knight: case black_knight: return 2;
+        case white_bishop: case black_bishop: return 3;
+        case white_rook: case black_rook: return 4;
+        case white_queen: case black_queen: return 5;
+        case white_king: case black_king: return 6;
+        default: return 0;
+    }
+}
+
+// ============================================================================
+// MovePicker Implementation
+// ============================================================================
+
+MovePicker::MovePicker(Board* board, MoveGenerator::Worker* moveGen, const Move& hashMove,
+                       const Move killers[2], const int (*history)[64])
+    : board(board), moveGen(moveGen), hashMove(hashMove), history(history),
+      stage(HASH_MOVE), current(0), captureEnd(0), badCurrent(0) {
+    this->killers[0] = killers[0];
+    this->killers[1] = killers[1];
+
+    if (hashMove.isNull() || !moveGen->isLegal(hashMove)) {
+        this->hashMove = Move();
+        stage = INIT_CAPTURES;
+    }
+}
+
+MovePicker::MovePicker(Board* board, MoveGenerator::Worker* moveGen)
+    : board(board), moveGen(moveGen), history(nullptr),
+      stage(Q_INIT_CAPTURES), current(0), captureEnd(0), badCurrent(0) {}
+
+Move MovePicker::next() {
+    switch (stage) {
+        case HASH_MOVE:
+            stage = INIT_CAPTURES;
+            return hashMove;
+
+        case INIT_CAPTURES:
+            moveGen->generateLegalCaptures(moves);
+            scoreCaptures(true);
+            captureEnd = moves.size();
+            stage = GOOD_CAPTURES;
+            [[fallthrough]];
+
+        case GOOD_CAPTURES:
+            while (current < captureEnd) {
+                ScoredMove& sm = selectBest(captureEnd);
+                if (sm.score < 0) break;  // Only bad captures left
+                current++;
+                if (sm.move != hashMove) return sm.move;
+            }
+            badCurrent = current;
+            stage = KILLER_1;
+            [[fallthrough]];
+
+        case KILLER_1:
+            stage = KILLER_2;
+            if (isUsableKiller(killers[0])) return killers[0];
+            [[fallthrough]];
+
+        case KILLER_2:
+            stage = INIT_QUIETS;
+            if (isUsableKiller(killers[1])) return killers[1];
+            [[fallthrough]];
+
+        case INIT_QUIETS:
+            moveGen->generateLegalQuiets(moves);
+            current = captureEnd;
+            scoreQuiets();
+            stage = QUIETS;
+            [[fallthrough]];
+
+        case QUIETS:
+            while (current < moves.size()) {
+                const Move move = selectBest(moves.size()).move;
+                current++;
+                if (move != hashMove && !isKiller(move)) return move;
+            }
+            current = badCurrent;
+            stage = BAD_CAPTURES;
+            [[fallthrough]];
+
+        case BAD_CAPTURES:
+            while (current < captureEnd) {
+                const Move move = selectBest(captureEnd).move;
+                current++;
+                if (move != hashMove) return move;
+            }
+            stage = DONE;
+            return Move();
+
+        case Q_INIT_CAPTURES:
+            moveGen->generateLegalCaptures(moves);
+            scoreCaptures(false);
+            stage = Q_CAPTURES;
+            [[fallthrough]];
+
+        case Q_CAPTURES:
+            if (current < moves.size()) {
+                const Move move = selectBest(moves.size()).move;
+                current++;
+                return move;
+            }
+            stage = DONE;
+            return Move();
+
+        default:
+            return Move();
+    }
+}
+
+ScoredMove& MovePicker::selectBest(int end) {
+    int best = current;
+    for (int i = current + 1; i < end; i++) {
+        if (moves[i].score > moves[best].score) best = i;
+    }
+    std::swap(moves[current], moves[best]);
+    return moves[current];
+}
+
+void MovePicker::scoreCaptures(bool splitBad) {
+    bool isWhite = board->isWhiteTurn();
+
+    for (auto& sm : moves) {
+        const Move move = sm.move;
+        int attacker = board->pieceOn(move.from());
+        int victim = move.type() == EN_PASSANT ? (isWhite ? black_pawn : white_pawn)
+                                               : board->pieceOn(move.to());
+
+        sm.score = MVV_LVA[getPieceIndex(attacker)][getPieceIndex(victim)] * 100;
+        if (move.type() == PROMOTION && move.promotionPiece(isWhite) == (isWhite ? white_queen : black_queen)) {
+            sm.score += QUEEN_PROMOTION_BONUS;
+        }
+
+        // Captures that lose material in the exchange wait until after the quiets
+        if (splitBad && !moveGen->seeGE(move, 0)) {
+            sm.score -= BAD_CAPTURE_PENALTY;
+        }
+    }
+}
+
+void MovePicker::scoreQuiets() {
+    for (int i = captureEnd; i < moves.size(); i++) {
+        const Move move = moves[i].move;
+        moves[i].score = history[move.from()][move.to()];
+    }
+}
+
+bool MovePicker::isCapture(const Move& move) const {
+    return move.type() == EN_PASSANT || board->pieceOn(move.to()) != -1;
+}
+
+bool MovePicker::isKiller(const Move& move) const {
+    return move == killers[0] || move == killers[1];
+}
+
+bool MovePicker::isUsableKiller(const Move& move) {
+    return !move.isNull() && move != hashMove && !isCapture(move) && move.type() != PROMOTION &&
+           moveGen->isLegal(move);
+}
+
+} // namespace Search
@@ -0,0 +1,407 @@
+#include "perft.h"
+#include "uci.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Perft {
+
+// ============================================================================
+// Standard positions
+// ============================================================================
+
+static const SuiteEntry SUITE[] = {
+    // Start position
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609ULL},
+    // Kiwipete
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603ULL},
+    // Rook endgame with en passant pins
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624ULL},
+    // Promotions and castling in check
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333ULL},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487ULL},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL},
+    
+    // Illegal en passant (capturing pawn pinned / discovered check)
+    {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888ULL},
+    {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133ULL},
+    // En passant capture gives check
+    {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467ULL},
+    // Castling gives check / castling rights / castling prevented
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072ULL},
+    {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711ULL},
+    {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206ULL},
+    {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476ULL},
+    // Promotions out of check, into check and under-promotions
+    {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001ULL},
+    {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342ULL},
+    {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683ULL},
+    // Discovered check, stalemate and checkmate
+    {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658ULL},
+    {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217ULL},
+    {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584ULL},
+    {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527ULL}
+};
+
+// ============================================================================
+// HashTable Implementation
+// ============================================================================
+
+HashTable::HashTable(size_t megabytes) {
+    count = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(Entry));
+    entries = std::make_unique<Entry[]>(count);
+}
+
+HashTable::Entry& HashTable::entryFor(uint64_t key) const {
+    size_t index = static_cast<size_t>((static_cast<unsigned __int128>(key) * count) >> 64);
+    return entries[index];
+}
+
+bool HashTable::probe(uint64_t key, int depth, uint64_t& nodes) const {
+    Entry& entry = entryFor(key);
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.keyXorData.load(std::memory_order_relaxed);
+    
+    if ((check ^ data) != key || (data & 0xFF) != static_cast<uint64_t>(depth)) return false;
+    nodes = data >> 8;
+    return true;
+}
+
+void HashTable::store(uint64_t key, int depth, uint64_t nodes) {
+    Entry& entry = entryFor(key);
+    uint64_t data = (nodes << 8) | static_cast<uint8_t>(depth);
+    entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Worker Implementation
+// ============================================================================
+
+Worker::Worker(Board* board, HashTable* hash) : board(board), moveGen(board), hash(hash) {}
+
+uint64_t Worker::perft(int depth) {
+    uint64_t nodes = 0;
+    if (hash && depth > 1 && hash->probe(board->getKey(), depth, nodes)) {
+        return nodes;
+    }
+    
+    MoveList moves;
+    moveGen.generateLegalMoves(moves);
+    
+    // Bulk counting: the legal move count is the leaf count
+    if (depth <= 1) {
+        return moves.size();
+    }
+    
+    for (const auto& sm : moves) {
+        board->makeMove(sm.move);
+        nodes += perft(depth - 1);
+        board->unmakeMove();
+    }
+    
+    if (hash) hash->store(board->getKey(), depth, nodes);
+    return nodes;
+}
+
+uint64_t Worker::divide(int depth) {
+    auto start = std::chrono::steady_clock::now();
+    
+    MoveList moves;
+    moveGen.generateLegalMoves(moves);
+    
+    uint64_t total = 0;
+    for (const auto& sm : moves) {
+        uint64_t nodes = 1;
+        if (depth > 1) {
+            board->makeMove(sm.move);
+            nodes = perft(depth - 1);
+            board->unmakeMove();
+        }
+        
+        std::cout << UCI::Utils::moveToUCI(sm.move) << ": " << nodes << std::endl;
+        total += nodes;
+    }
+    
+    auto end = std::chrono::steady_clock::now();
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    
+    std::cout << "\nMoves: " << moves.size() << std::endl;
+    std::cout << "Nodes: " << total << std::endl;
+    std::cout << "Time (ms): " << ms << std::endl;
+    std::cout << "Nodes/second: " << (ms > 0 ? total * 1000 / ms : total) << std::endl;
+    
+    return total;
+}
+
+uint64_t Worker::run(int depth) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = perft(depth);
+    auto end = std::chrono::steady_clock::now();
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    
+    std::cout << "info string perft " << depth 
+              << " nodes " << nodes 
+              << " time " << ms 
+              << " nps " << (ms > 0 ? nodes * 1000 / ms : nodes) << std::endl;
+    
+    return nodes;
+}
+
+uint64_t Worker::verify(int depth, const MoveList* grandparent, const MoveList* parent) {
+    MoveList legal;
+    MoveList pseudo;
+    MoveList filtered;
+    MoveList staged;
+    moveGen.generateLegalMoves(legal);
+    moveGen.generateAllMoves(pseudo);
+    filtered = pseudo;
+    moveGen.filterLegalMoves(filtered);
+    
+    // Captures followed by quiets (as the move picker generates them) must give the same set
+    moveGen.generateLegalCaptures(staged);
+    moveGen.generateLegalQuiets(staged);
+    
+    auto byData = [](const ScoredMove& a, const ScoredMove& b) { return a.move.data < b.move.data; };
+    auto sameMove = [](const ScoredMove& a, const ScoredMove& b) { return a.move == b.move; };
+    std::sort(legal.begin(), legal.end(), byData);
+    std::sort(pseudo.begin(), pseudo.end(), byData);
+    std::sort(filtered.begin(), filtered.end(), byData);
+    std::sort(staged.begin(), staged.end(), byData);
+    
+    uint64_t mismatches = 0;
+    bool same = legal.size() == filtered.size() && legal.size() == staged.size() &&
+                std::equal(legal.begin(), legal.end(), filtered.begin(), sameMove) &&
+                std::equal(legal.begin(), legal.end(), staged.begin(), sameMove);
+    if (!same) {
+        mismatches++;
+        std::cout << "mismatch: legal";
+        for (const auto& sm : legal) std::cout << " " << UCI::Utils::moveToUCI(sm.move);
+        std::cout << "\n          filtered";
+        for (const auto& sm : filtered) std::cout << " " << UCI::Utils::moveToUCI(sm.move);
+        std::cout << std::endl;
+    }
+    
+    // The direct checks must agree with the generated lists, both for this
+    // node's own moves and for the moves two plies up (same side to move,
+    // what a killer or a colliding hash move looks like)
+    auto contains = [&](const MoveList& list, const Move& move) {
+        return std::binary_search(list.begin(), list.end(), ScoredMove(move, 0), byData);
+    };
+    auto checkDirect = [&](const MoveList& candidates) {
+        for (const auto& sm : candidates) {
+            if (moveGen.isPseudoLegal(sm.move) != contains(pseudo, sm.move) ||
+                moveGen.isLegal(sm.move) != contains(legal, sm.move)) {
+                mismatches++;
+                std::cout << "mismatch: isPseudoLegal/isLegal " << UCI::Utils::moveToUCI(sm.move) << std::endl;
+                return;
+            }
+        }
+    };
+    checkDirect(pseudo);
+    if (grandparent) checkDirect(*grandparent);
+    
+    // Once the attack maps are cached, king moves and the direct checks read them instead
+    MoveList cached;
+    moveGen.attackedBy(MoveGenerator::WHITE);
+    moveGen.attackedBy(MoveGenerator::BLACK);
+    moveGen.generateLegalMoves(cached);
+    std::sort(cached.begin(), cached.end(), byData);
+    if (cached.size() != legal.size() || !std::equal(legal.begin(), legal.end(), cached.begin(), sameMove)) {
+        mismatches++;
+        std::cout << "mismatch: legal with cached attack maps";
+        for (const auto& sm : cached) std::cout << " " << UCI::Utils::moveToUCI(sm.move);
+        std::cout << std::endl;
+    }
+    checkDirect(pseudo);
+    
+    if (depth > 1) {
+        for (const auto& sm : filtered) {
+            board->makeMove(sm.move);
+            mismatches += verify(depth - 1, parent, &pseudo);
+            board->unmakeMove();
+        }
+    }
+    
+    return mismatches;
+}
+
+// ============================================================================
+// Threads
+// ============================================================================
+
+namespace {
+    // Enough paths per thread to even out subtrees of very different sizes
+    constexpr size_t TASKS_PER_THREAD = 16;
+    constexpr int MAX_SPLIT_PLY = 4;
+    
+    struct Task {
+        Move path[MAX_SPLIT_PLY];
+        int length;
+    };
+    
+    void expand(Board& board, MoveGenerator::Worker& moveGen, Task& task, int plies, std::vector<Task>& tasks) {
+        if (task.length == plies) {
+            tasks.push_back(task);
+            return;
+        }
+        
+        MoveList moves;
+        moveGen.generateLegalMoves(moves);
+        for (const auto& sm : moves) {
+            task.path[task.length++] = sm.move;
+            board.makeMove(sm.move);
+            expand(board, moveGen, task, plies, tasks);
+            board.unmakeMove();
+            task.length--;
+        }
+    }
+}
+
+uint64_t runThreads(const Board& root, int depth, int threads, size_t hashMb) {
+    auto start = std::chrono::steady_clock::now();
+    
+    // Split one ply deeper until every thread has a good number of paths to take,
+    // leaving at least one ply (bulk counted) below each path
+    std::vector<Task> tasks;
+    Board board = root;
+    MoveGenerator::Worker moveGen(&board);
+    for (int plies = 1; plies < depth && plies <= MAX_SPLIT_PLY; plies++) {
+        tasks.clear();
+        Task task{};
+        expand(board, moveGen, task, plies, tasks);
+        if (tasks.size() >= TASKS_PER_THREAD * threads) break;
+    }
+    
+    std::unique_ptr<HashTable> hash;
+    if (hashMb > 0) hash = std::make_unique<HashTable>(hashMb);
+    
+    std::atomic<size_t> next{0};
+    std::atomic<uint64_t> total{0};
+    
+    auto work = [&]() {
+        Board local = root;
+        Worker worker(&local, hash.get());
+        uint64_t nodes = 0;
+        
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            const Task& task = tasks[i];
+            for (int j = 0; j < task.length; j++) local.makeMove(task.path[j]);
+            nodes += worker.perft(depth - task.length);
+            for (int j = 0; j < task.length; j++) local.unmakeMove();
+        }
+        
+        total += nodes;
+    };
+    
+    if (tasks.empty()) {
+        // Depth 1, or no legal moves: nothing worth splitting
+        Worker worker(&board, hash.get());
+        total = worker.perft(depth);
+    } else {
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; i++) pool.emplace_back(work);
+        work();
+        for (auto& t : pool) t.join();
+    }
+    
+    auto end = std::chrono::steady_clock::now();
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    uint64_t nodes = total;
+    
+    std::cout << "info string perft " << depth
+              << " nodes " << nodes
+              << " time " << ms
+              << " nps " << (ms > 0 ? nodes * 1000 / ms : nodes)
+              << " threads " << threads
+              << " tasks " << tasks.size()
+              << " hash " << hashMb << std::endl;
+    
+    return nodes;
+}
+
+// ============================================================================
+// Suite
+// ============================================================================
+
+bool runSuite(int maxDepth) {
+    int passed = 0;
+    int failed = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    for (const auto& entry : SUITE) {
+        if (maxDepth > 0 && entry.depth > maxDepth) continue;
+        
+        Board board(entry.fen);
+        Worker worker(&board);
+        uint64_t nodes = worker.perft(entry.depth);
+        totalNodes += nodes;
+        
+        bool ok = (nodes == entry.nodes);
+        if (ok) passed++; else failed++;
+        
+        std::cout << (ok ? "PASS" : "FAIL") 
+                  << " depth " << entry.depth 
+                  << " nodes " << nodes;
+        if (!ok) std::cout << " (expected " << entry.nodes << ")";
+        std::cout << "  " << entry.fen << std::endl;
+    }
+    
+    auto end = std::chrono::steady_clock::now();
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    
+    std::cout << "\n" << passed << " passed, " << failed << " failed" << std::endl;
+    std::cout << "Nodes: " << totalNodes << std::endl;
+    std::cout << "Time (ms): " << ms << std::endl;
+    std::cout << "Nodes/second: " << (ms > 0 ? totalNodes * 1000 / ms : totalNodes) << std::endl;
+    
+    return failed == 0;
+}
+
+bool runTables(int maxDepth) {
+    using MoveGenerator::AttackTables;
+    
+    int mismatches = AttackTables::verify();
+    std::cout << (mismatches == 0 ? "PASS" : "FAIL") << " slider table entries against rays, "
+              << mismatches << " mismatches"
+              << (AttackTables::isSupported(MoveGenerator::LOOKUP_PEXT) ? "" : " (PEXT not supported)") << std::endl;
+    
+    bool ok = mismatches == 0;
+    MoveGenerator::SliderLookup previous = AttackTables::getLookup();
+    
+    for (auto mode : {MoveGenerator::LOOKUP_RAYS, MoveGenerator::LOOKUP_MAGIC, MoveGenerator::LOOKUP_PEXT}) {
+        if (!AttackTables::setLookup(mode)) continue;
+        
+        std::cout << "\nSlider lookup: " << (mode == MoveGenerator::LOOKUP_RAYS ? "rays" :
+                                              mode == MoveGenerator::LOOKUP_MAGIC ? "magic" : "pext") << std::endl;
+        ok = runSuite(maxDepth) && ok;
+    }
+    
+    AttackTables::setLookup(previous);
+    return ok;
+}
+
+bool runVerify(int maxDepth) {
+    uint64_t totalMismatches = 0;
+    
+    for (const auto& entry : SUITE) {
+        Board board(entry.fen);
+        Worker worker(&board);
+        int depth = std::min(entry.depth, std::max(1, maxDepth));
+        uint64_t mismatches = worker.verify(depth);
+        totalMismatches += mismatches;
+        
+        std::cout << (mismatches == 0 ? "PASS" : "FAIL") 
+                  << " depth " << depth 
+                  << " mismatches " << mismatches 
+                  << "  " << entry.fen << std::endl;
+    }
+    
+    std::cout << "\nMismatching nodes: " << totalMismatches << std::endl;
+    return totalMismatches == 0;
+}
+
+} // namespace Perft
@@ -1,41 +1,107 @@
 #include "search.h"
+#include "uci.h"
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <iostream>
+#include <sstream>
 #include <cstring>
 
 namespace Search {
 
+// Quiescence goes on past MAX_PLY, on the board's state stack
+static_assert(MAX_PLY < MAX_STACK_PLY);
+
+// ============================================================================
+// Lazy SMP depth skipping: helper i skips depths where
+// ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) is odd, spreading helpers over depths
+// ============================================================================
+static const int SKIP_SIZE[20]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// ============================================================================
+// Aspiration windows: from ASPIRATION_MIN_DEPTH each iteration starts with
+// [score - ASPIRATION_DELTA, score + ASPIRATION_DELTA] around the previous
+// score, and the failed side is pushed out twice as far on every re-search
+// until the margin passes ASPIRATION_MAX_DELTA and the window is opened fully
+// ============================================================================
+static constexpr int ASPIRATION_MIN_DEPTH = 4;
+static constexpr int ASPIRATION_DELTA = 25;
+static constexpr int ASPIRATION_MAX_DELTA = 500;
+
+// ============================================================================
+// Frontier pruning margins (centipawns), indexed by remaining depth:
+// reverse futility fails high at RFP_MARGIN * depth above beta, futility skips
+// quiet moves FUTILITY_MARGIN[depth] below alpha, razoring drops to
+// quiescence RAZOR_MARGIN[depth] below alpha
 // ============================================================================
-// MVV-LVA (Most Valuable Victim - Least Valuable Attacker) scores
+static constexpr int RFP_MAX_DEPTH = 3;
+static constexpr int RFP_MARGIN = 90;
+static constexpr int FUTILITY_MAX_DEPTH = 3;
+static constexpr int FUTILITY_MARGIN[FUTILITY_MAX_DEPTH + 1] = {0, 150, 300, 450};
+static constexpr int RAZOR_MAX_DEPTH = 2;
+static constexpr int RAZOR_MARGIN[RAZOR_MAX_DEPTH + 1] = {0, 300, 550};
+
+// ============================================================================
+// Null move pruning: R = NMP_BASE_REDUCTION + depth / NMP_DEPTH_DIVISOR.
+// Cutoffs from NMP_VERIFY_DEPTH up, or with at most NMP_VERIFY_PHASE of
+// material left (where zugzwang is likely), are confirmed by a reduced
+// search without the null move
+// ============================================================================
+static constexpr int NMP_MIN_DEPTH = 3;
+static constexpr int NMP_BASE_REDUCTION = 2;
+static constexpr int NMP_DEPTH_DIVISOR = 4;
+static constexpr int NMP_VERIFY_DEPTH = 10;
+static constexpr int NMP_VERIFY_PHASE = 4;
+
 // ============================================================================
-static const int MVV_LVA[7][7] = {
-    {0,  0,  0,  0,  0,  0,  0},
-    {0, 15, 25, 35, 45, 55, 0},
-    {0, 14, 24, 34, 44, 54, 0},
-    {0, 13, 23, 33, 43, 53, 0},
-    {0, 12, 22, 32, 42, 52, 0},
-    {0, 11, 21, 31, 41, 51, 0},
-    {0, 10, 20, 30, 40, 50, 0}
-};
+// Late move reductions: REDUCTIONS[depth][moveCount] =
+// LMR_BASE + ln(depth) * ln(moveCount) / LMR_DIVISOR, filled once at startup.
+// Quiet moves after the first LMR_MIN_MOVES are searched that much shallower,
+// less for good history, killers, checks and PV nodes
+// ============================================================================
+static constexpr double LMR_BASE = 0.75;
+static constexpr double LMR_DIVISOR = 2.25;
+static constexpr int LMR_MIN_DEPTH = 3;
+static constexpr int LMR_MIN_MOVES = 3;
+static constexpr int LMR_HISTORY_DIVISOR = 8192;
+static constexpr int LMR_MAX_MOVES = 64;
+
+using ReductionTable = std::array<std::array<int, LMR_MAX_MOVES>, MAX_PLY>;
 
-static int getPieceIndex(PieceType pt) {
-    switch (pt) {
-        case white_pawn: case black_pawn: return 1;
-        case white_knight: case black_knight: return 2;
-        case white_bishop: case black_bishop: return 3;
-        case white_rook: case black_rook: return 4;
-        case white_queen: case black_queen: return 5;
-        case white_king: case black_king: return 6;
-        default: return 0;
+static ReductionTable initReductions() {
+    ReductionTable table{};
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        for (int moves = 1; moves < LMR_MAX_MOVES; moves++) {
+            table[depth][moves] = static_cast<int>(LMR_BASE + std::log(depth) * std::log(moves) / LMR_DIVISOR);
+        }
     }
+    return table;
+}
+
+static const ReductionTable REDUCTIONS = initReductions();
+
+// A rook, a queen or two minor pieces for the side to move: with only pawns
+// and at most one minor passing is often the best move (zugzwang) and null
+// move would be unsound, verification or not
+static bool hasNullMoveMaterial(Board& board) {
+    bool white = board.isWhiteTurn();
+    uint64_t majors = board.positions[white ? white_rook : black_rook] |
+                      board.positions[white ? white_queen : black_queen];
+    uint64_t minors = board.positions[white ? white_knight : black_knight] |
+                      board.positions[white ? white_bishop : black_bishop];
+    return majors || (minors & (minors - 1));
 }
 
 // ============================================================================
 // Worker Implementation
 // ============================================================================
 
-Worker::Worker(Board* board, MoveGenerator::Worker* moveGen, Eval::Worker* evaluator)
-    : board(board), moveGen(moveGen), evaluator(evaluator), stopped(false), allocatedTime(-1) {
+Worker::Worker(Board* board, MoveGenerator::Worker* moveGen, Eval::Worker* evaluator, 
+               TranspositionTable* tt, int threadId)
+    : board(board), moveGen(moveGen), evaluator(evaluator), tt(tt), threadId(threadId), 
+      stopped(false), publishedNodes(0), rootWhite(true), nmpMinPly(0), nmpWhite(true),
+      allocatedTime(-1), pondering(false), ponderhitTicks(0) {
     clearTables();
 }
 
@@ -60,10 +126,17 @@ void Worker::clearTables() {
 SearchResult Worker::search(const SearchLimits& limits) {
     SearchResult result;
     currentLimits = limits;
-    stopped = false;
     stats.reset();
+    publishedNodes = 0;
+    nmpMinPly = 0;
+    rootWhite = board->isWhiteTurn();
     clearTables();
     
+    // The table ages once per search, helpers share the main thread's generation
+    if (threadId == 0) {
+        tt->newSearch();
+    }
+    
     searchStartTime = std::chrono::steady_clock::now();
     allocatedTime = calculateTimeAllocation();
     
@@ -72,10 +145,54 @@ SearchResult Worker::search(const SearchLimits& limits) {
     
     // Iterative deepening
     for (int depth = 1; depth <= maxDepth && !stopped; depth++) {
+        if (threadId > 0) {
+            int i = (threadId - 1) % 20;
+            if (((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) continue;
+        }
+        
         stats.depth = depth;
-        pvLength[0] = 0;
         
-        int score = alphaBeta(depth, -INFINITY_SCORE, INFINITY_SCORE, 0, true);
+        // Aspiration window around the last score, widened on each fail
+        int delta = ASPIRATION_DELTA;
+        int alpha = -INFINITY_SCORE;
+        int beta = INFINITY_SCORE;
+        if (depth >= ASPIRATION_MIN_DEPTH && result.depth > 0 && std::abs(result.score) < MATE_THRESHOLD) {
+            alpha = std::max(result.score - delta, -INFINITY_SCORE);
+            beta = std::min(result.score + delta, INFINITY_SCORE);
+        }
+        
+        int score;
+        while (true) {
+            pvLength[0] = 0;
+            score = alphaBeta(depth, alpha, beta, 0, true);
+            
+            if (stopped) {
+                break;
+            }
+            
+            if (score <= alpha) {
+                // Nothing reached the window: the old PV is all we have
+                if (threadId == 0) {
+                    sendInfo(depth, alpha, result.pv, BOUND_UPPER);
+                }
+                beta = (alpha + beta) / 2;
+                alpha = std::max(score - delta, -INFINITY_SCORE);
+            } else if (score >= beta) {
+                if (threadId == 0) {
+                    sendInfo(depth, beta, extractPV(depth), BOUND_LOWER);
+                }
+                beta = std::min(score + delta, INFINITY_SCORE);
+            } else {
+                break;
+            }
+            
+            // Far off the expected score: stop guessing and open the window
+            delta *= 2;
+            if (delta > ASPIRATION_MAX_DELTA) {
+                alpha = -INFINITY_SCORE;
+                beta = INFINITY_SCORE;
+            }
+        }
         
         if (stopped && depth > 1) {
             break;
@@ -89,7 +206,9 @@ SearchResult Worker::search(const SearchLimits& limits) {
             result.pv = extractPV(depth);
             result.stats = stats;
             
-            sendInfo(depth, score, result.pv);
+            if (threadId == 0) {
+                sendInfo(depth, score, result.pv);
+            }
         }
         
         // Check for mate
@@ -98,11 +217,12 @@ SearchResult Worker::search(const SearchLimits& limits) {
         }
         
         // Time management
-        if (allocatedTime > 0 && stats.elapsedMs() > allocatedTime / 2) {
+        if (allocatedTime > 0 && !pondering && timeUsedMs() > allocatedTime / 2) {
             break;
         }
     }
     
+    publishedNodes.store(stats.nodes + stats.qnodes, std::memory_order_relaxed);
     return result;
 }
 
@@ -118,6 +238,10 @@ int Worker::alphaBeta(int depth, int alpha, int beta, int ply, bool isPV) {
     
     pvLength[ply] = ply;
     
+    if (ply > 0 && isDraw(ply)) {
+        return drawScore();
+    }
+    
     // Leaf node - go to quiescence
     if (depth <= 0) {
         return quiescence(alpha, beta, ply);
@@ -129,51 +253,147 @@ int Worker::alphaBeta(int depth, int alpha, int beta, int ply, bool isPV) {
         return evaluator->evaluate();
     }
     
+    // Transposition table lookup
+    uint64_t key = board->getKey();
+    TTData ttData;
+    bool ttHit = tt->probe(key, ttData);
+    Move hashMove = ttHit ? ttData.move : Move();
+    
+    if (ttHit) {
+        stats.hashHits++;
+        
+        // Cut off at non-PV nodes when the stored bound already decides the window
+        if (!isPV && ply > 0 && ttData.depth >= depth) {
+            int ttScore = scoreFromTT(ttData.score, ply);
+            if (ttData.bound == BOUND_EXACT ||
+                (ttData.bound == BOUND_LOWER && ttScore >= beta) ||
+                (ttData.bound == BOUND_UPPER && ttScore <= alpha)) {
+                return ttScore;
+            }
+        }
+    }
+    
     bool inCheck = moveGen->isInCheck();
+    int staticEval = inCheck ? -INFINITY_SCORE : evaluator->evaluate();
     
-    // Check extension
-    if (inCheck && depth < MAX_PLY - ply) {
-        depth++;
+    // Reverse futility: a static eval that beats beta by a depth-scaled margin
+    // is not going to drop below it in the few plies left
+    if (!isPV && !inCheck && depth <= RFP_MAX_DEPTH && std::abs(beta) < MATE_THRESHOLD
+        && staticEval - RFP_MARGIN * depth >= beta) {
+        return beta;
     }
     
-    // Generate moves
-    std::vector<Move> pseudoMoves = moveGen->generateAllMoves();
-    std::vector<Move> legalMoves = moveGen->filterLegalMoves(pseudoMoves);
+    // Razoring: far below alpha near the leaves, only captures can bring the
+    // score back, so let quiescence decide
+    if (!isPV && !inCheck && depth <= RAZOR_MAX_DEPTH && std::abs(alpha) < MATE_THRESHOLD
+        && staticEval + RAZOR_MARGIN[depth] < alpha) {
+        int razorScore = quiescence(alpha - 1, alpha, ply);
+        if (stopped) {
+            return 0;
+        }
+        if (razorScore < alpha) {
+            return razorScore;
+        }
+    }
     
-    if (legalMoves.empty()) {
-        if (inCheck) {
-            return -MATE_SCORE + ply;
+    // Null move pruning: if passing still fails high after a reduced search,
+    // a real move almost certainly would too
+    if (!isPV && !inCheck && depth >= NMP_MIN_DEPTH && !board->lastMoveIsNull()
+        && beta > -MATE_THRESHOLD && hasNullMoveMaterial(*board)
+        && (ply >= nmpMinPly || board->isWhiteTurn() != nmpWhite)
+        && staticEval >= beta && board->makeNullMove()) {
+        int reduction = NMP_BASE_REDUCTION + depth / NMP_DEPTH_DIVISOR;
+        
+        int nullScore = -alphaBeta(depth - 1 - reduction, -beta, -beta + 1, ply + 1, false);
+        board->unmakeNullMove();
+        
+        if (stopped) {
+            return 0;
+        }
+        
+        if (nullScore >= beta) {
+            // A mate found after passing is not a proven mate
+            if (nullScore >= MATE_THRESHOLD) {
+                nullScore = beta;
+            }
+            
+            // Already verifying higher up: nmpMinPly belongs to that search
+            if (nmpMinPly > 0 || (depth < NMP_VERIFY_DEPTH && board->getPhase() > NMP_VERIFY_PHASE)) {
+                return nullScore;
+            }
+            
+            // Verification: same reduced depth, this side may not pass again
+            // for most of it, so a zugzwang shows up as a fail low
+            nmpMinPly = ply + 3 * (depth - reduction) / 4;
+            nmpWhite = board->isWhiteTurn();
+            int verifyScore = alphaBeta(depth - reduction, beta - 1, beta, ply, false);
+            nmpMinPly = 0;
+            
+            if (stopped) {
+                return 0;
+            }
+            
+            if (verifyScore >= beta) {
+                return nullScore;
+            }
         }
-        return 0;
     }
     
-    // Score and sort moves
-    std::vector<ScoredMove> scoredMoves;
-    scoredMoves.reserve(legalMoves.size());
-    for (const auto& move : legalMoves) {
-        scoredMoves.push_back(ScoredMove(move, 0));
+    // Check extension
+    if (inCheck && depth < MAX_PLY - ply) {
+        depth++;
     }
-    scoreMoves(scoredMoves, ply, Move());
-    std::sort(scoredMoves.begin(), scoredMoves.end());
     
+    // Futility: quiet moves that don't give check can't lift a static eval
+    // this far below alpha in the plies left
+    bool futile = !isPV && !inCheck && depth <= FUTILITY_MAX_DEPTH && std::abs(alpha) < MATE_THRESHOLD
+                  && staticEval + FUTILITY_MARGIN[depth] <= alpha;
+    
+    MovePicker picker(board, moveGen, hashMove, killerMoves[ply], historyTable);
+    
+    int originalAlpha = alpha;
     int bestScore = -INFINITY_SCORE;
+    Move bestMove;
     int moveCount = 0;
     
-    for (const auto& sm : scoredMoves) {
-        const Move& move = sm.move;
+    for (Move move = picker.next(); !move.isNull(); move = picker.next()) {
         moveCount++;
         
+        bool isQuiet = !isCapture(move) && move.type() != PROMOTION;
+        bool isKiller = move == killerMoves[ply][0] || move == killerMoves[ply][1];
+        
         if (!board->makeMove(move)) {
             continue;
         }
         
+        if (futile && moveCount > 1 && isQuiet && !moveGen->isInCheck()) {
+            board->unmakeMove();
+            continue;
+        }
+        
         int score;
         
         if (moveCount == 1) {
             score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, isPV);
         } else {
+            // Late quiet moves rarely raise alpha: try them at a reduced depth first
+            int reduction = 0;
+            if (depth >= LMR_MIN_DEPTH && moveCount > LMR_MIN_MOVES && isQuiet && !inCheck) {
+                reduction = REDUCTIONS[std::min(depth, MAX_PLY - 1)][std::min(moveCount, LMR_MAX_MOVES - 1)];
+                reduction -= historyTable[move.from()][move.to()] / LMR_HISTORY_DIVISOR;
+                if (isKiller) reduction--;
+                if (isPV) reduction--;
+                if (moveGen->isInCheck()) reduction--;
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+            
             // PVS: null window search first
-            score = -alphaBeta(depth - 1, -alpha - 1, -alpha, ply + 1, false);
+            score = -alphaBeta(depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, false);
+            
+            // A reduced move that beats alpha gets its full depth back
+            if (!stopped && reduction > 0 && score > alpha) {
+                score = -alphaBeta(depth - 1, -alpha - 1, -alpha, ply + 1, false);
+            }
             
             if (!stopped && score > alpha && score < beta) {
                 score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, isPV);
@@ -188,6 +408,7 @@ int Worker::alphaBeta(int depth, int alpha, int beta, int ply, bool isPV) {
         
         if (score > bestScore) {
             bestScore = score;
+            bestMove = move;
             
             if (score > alpha) {
                 alpha = score;
@@ -200,16 +421,28 @@ int Worker::alphaBeta(int depth, int alpha, int beta, int ply, bool isPV) {
                 pvLength[ply] = pvLength[ply + 1];
                 
                 if (score >= beta) {
-                    if (!isCapture(move)) {
+                    if (isQuiet) {
                         updateKillers(move, ply);
                         updateHistory(move, depth);
                     }
+                    tt->store(key, move, scoreToTT(beta, ply), depth, BOUND_LOWER);
                     return beta;
                 }
             }
         }
     }
     
+    if (moveCount == 0) {
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+    
+    // A fail-low node has no meaningful best move
+    if (alpha > originalAlpha) {
+        tt->store(key, bestMove, scoreToTT(bestScore, ply), depth, BOUND_EXACT);
+    } else {
+        tt->store(key, Move(), scoreToTT(bestScore, ply), depth, BOUND_UPPER);
+    }
+    
     return bestScore;
 }
 
@@ -235,20 +468,14 @@ int Worker::quiescence(int alpha, int beta, int ply) {
         alpha = standPat;
     }
     
-    // Generate only captures
-    std::vector<Move> captures = moveGen->generateCaptures();
-    std::vector<Move> legalCaptures = moveGen->filterLegalMoves(captures);
-    
-    // Sort captures by MVV-LVA
-    std::vector<ScoredMove> scoredCaptures;
-    for (const auto& move : legalCaptures) {
-        int score = getMvvLvaScore(move);
-        scoredCaptures.push_back(ScoredMove(move, score));
-    }
-    std::sort(scoredCaptures.begin(), scoredCaptures.end());
+    // Captures only, most valuable victim first
+    MovePicker picker(board, moveGen);
     
-    for (const auto& sm : scoredCaptures) {
-        const Move& move = sm.move;
+    for (Move move = picker.next(); !move.isNull(); move = picker.next()) {
+        // Captures that lose material in the exchange are not worth searching
+        if (!moveGen->seeGE(move, 0)) {
+            continue;
+        }
         
         if (!board->makeMove(move)) {
             continue;
@@ -274,60 +501,32 @@ int Worker::quiescence(int alpha, int beta, int ply) {
     return alpha;
 }
 
-void Worker::scoreMoves(std::vector<ScoredMove>& moves, int ply, const Move& hashMove) {
-    for (auto& sm : moves) {
-        const Move& move = sm.move;
-        
-        // Hash move
-        if (hashMove.from != 0 && move.from == hashMove.from && move.to == hashMove.to) {
-            sm.score = 100000;
-            continue;
-        }
-        
-        // Captures
-        if (isCapture(move)) {
-            sm.score = 50000 + getMvvLvaScore(move);
-            continue;
-        }
-        
-        // Killer moves
-        if (ply < MAX_PLY) {
-            if (killerMoves[ply][0].from == move.from && killerMoves[ply][0].to == move.to) {
-                sm.score = 40000;
-                continue;
-            }
-            if (killerMoves[ply][1].from == move.from && killerMoves[ply][1].to == move.to) {
-                sm.score = 39000;
-                continue;
-            }
-        }
-        
-        // History
-        int from = move.from - 1;
-        int to = move.to - 1;
-        if (from >= 0 && from < 64 && to >= 0 && to < 64) {
-            sm.score = historyTable[from][to];
-        }
+bool Worker::isDraw(int ply) {
+    if (board->isRepetition(ply)) {
+        return true;
     }
-}
-
-int Worker::getMvvLvaScore(const Move& move) {
-    int capturedPiece = board->getPieceAt(move.to);
-    if (capturedPiece == -1) return 0;
     
-    int attackingPiece = board->getPieceAt(move.from);
-    if (attackingPiece == -1) return 0;
+    if (board->half_clock < 100) {
+        return false;
+    }
     
-    int victimIdx = getPieceIndex(static_cast<PieceType>(capturedPiece));
-    int attackerIdx = getPieceIndex(static_cast<PieceType>(attackingPiece));
+    if (!moveGen->isInCheck()) {
+        return true;
+    }
     
-    return MVV_LVA[attackerIdx][victimIdx] * 100;
+    MoveList moves;
+    moveGen->generateLegalMoves(moves);
+    return !moves.empty();
+}
+
+int Worker::drawScore() {
+    return board->isWhiteTurn() == rootWhite ? -currentLimits.contempt : currentLimits.contempt;
 }
 
 void Worker::updateKillers(const Move& move, int ply) {
     if (ply >= MAX_PLY) return;
     
-    if (killerMoves[ply][0].from == move.from && killerMoves[ply][0].to == move.to) {
+    if (killerMoves[ply][0] == move) {
         return;
     }
     
@@ -336,17 +535,15 @@ void Worker::updateKillers(const Move& move, int ply) {
 }
 
 void Worker::updateHistory(const Move& move, int depth) {
-    int from = move.from - 1;
-    int to = move.to - 1;
+    int from = move.from();
+    int to = move.to();
     
-    if (from >= 0 && from < 64 && to >= 0 && to < 64) {
-        historyTable[from][to] += depth * depth;
-        
-        if (historyTable[from][to] > 30000) {
-            for (int i = 0; i < 64; i++) {
-                for (int j = 0; j < 64; j++) {
-                    historyTable[i][j] /= 2;
-                }
+    historyTable[from][to] += depth * depth;
+    
+    if (historyTable[from][to] > 30000) {
+        for (int i = 0; i < 64; i++) {
+            for (int j = 0; j < 64; j++) {
+                historyTable[i][j] /= 2;
             }
         }
     }
@@ -355,12 +552,14 @@ void Worker::updateHistory(const Move& move, int depth) {
 bool Worker::shouldStop() {
     if (stopped) return true;
     
+    publishedNodes.store(stats.nodes + stats.qnodes, std::memory_order_relaxed);
+    
     if (currentLimits.maxNodes > 0 && stats.nodes >= currentLimits.maxNodes) {
         return true;
     }
     
-    if (allocatedTime > 0 && (stats.nodes & 1023) == 0) {
-        if (stats.elapsedMs() >= allocatedTime) {
+    if (allocatedTime > 0 && !pondering && ((stats.nodes + stats.qnodes) & 1023) == 0) {
+        if (timeUsedMs() >= allocatedTime) {
             return true;
         }
     }
@@ -396,7 +595,7 @@ std::vector<Move> Worker::extractPV(int depth) {
     std::vector<Move> pv;
     
     for (int i = 0; i < pvLength[0] && i < depth && i < MAX_PLY; i++) {
-        if (pvTable[0][i].from == 0 && pvTable[0][i].to == 0) break;
+        if (pvTable[0][i].isNull()) break;
         pv.push_back(pvTable[0][i]);
     }
     
@@ -404,63 +603,98 @@ std::vector<Move> Worker::extractPV(int depth) {
 }
 
 bool Worker::isCapture(const Move& move) {
-    return board->isOccupied(move.to);
+    return move.type() == EN_PASSANT || board->isOccupied(move.to() + 1);
 }
 
 void Worker::stop() {
     stopped = true;
 }
 
-void Worker::sendInfo(int depth, int score, const std::vector<Move>& pv) {
+void Worker::prepare(bool ponder) {
+    stopped = false;
+    pondering = ponder;
+    ponderhitTicks = 0;
+}
+
+void Worker::ponderhit() {
+    ponderhitTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    pondering = false;
+}
+
+long long Worker::timeUsedMs() const {
+    // The clock runs from the later of search start and ponderhit
+    auto start = stats.startTime;
+    long long ticks = ponderhitTicks.load(std::memory_order_relaxed);
+    if (ticks > start.time_since_epoch().count()) {
+        start = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+}
+
+void Worker::sendInfo(int depth, int score, const std::vector<Move>& pv, Bound bound) {
     long long elapsed = stats.elapsedMs();
     long long nodes = stats.nodes + stats.qnodes;
+    for (const Worker* peer : peers) {
+        nodes += peer->nodesSearched();
+    }
     long long nps = (elapsed > 0) ? (nodes * 1000 / elapsed) : 0;
     
-    std::cout << "info";
-    std::cout << " depth " << depth;
-    std::cout << " seldepth " << stats.selDepth;
+    // Built as one line so it cannot interleave with output from the UCI thread
+    std::ostringstream out;
+    out << "info";
+    out << " depth " << depth;
+    out << " seldepth " << stats.selDepth;
     
     if (score > MATE_THRESHOLD) {
         int mateIn = (MATE_SCORE - score + 1) / 2;
-        std::cout << " score mate " << mateIn;
+        out << " score mate " << mateIn;
     } else if (score < -MATE_THRESHOLD) {
         int mateIn = (-MATE_SCORE - score) / 2;
-        std::cout << " score mate " << mateIn;
+        out << " score mate " << mateIn;
     } else {
-        std::cout << " score cp " << score;
+        out << " score cp " << score;
+    }
+    
+    if (bound == BOUND_LOWER) {
+        out << " lowerbound";
+    } else if (bound == BOUND_UPPER) {
+        out << " upperbound";
     }
     
-    std::cout << " nodes " << nodes;
-    std::cout << " nps " << nps;
-    std::cout << " time " << elapsed;
+    out << " nodes " << nodes;
+    out << " nps " << nps;
+    out << " hashfull " << tt->hashfull();
+    out << " time " << elapsed;
     
     if (!pv.empty()) {
-        std::cout << " pv";
+        out << " pv";
         for (const auto& move : pv) {
-            int fromFile = (move.from - 1) % 8;
-            int fromRank = (move.from - 1) / 8;
-            int toFile = (move.to - 1) % 8;
-            int toRank = (move.to - 1) / 8;
+            int fromFile = move.from() % 8;
+            int fromRank = move.from() / 8;
+            int toFile = move.to() % 8;
+            int toRank = move.to() / 8;
             
-            std::cout << " " 
-                      << static_cast<char>('a' + fromFile) 
-                      << static_cast<char>('1' + fromRank)
-                      << static_cast<char>('a' + toFile) 
-                      << static_cast<char>('1' + toRank);
+            out << " " 
+                << static_cast<char>('a' + fromFile) 
+                << static_cast<char>('1' + fromRank)
+                << static_cast<char>('a' + toFile) 
+                << static_cast<char>('1' + toRank);
             
-            if (move.type == PROMOTION) {
-                switch (move.promotionPiece) {
-                    case white_queen: case black_queen: std::cout << "q"; break;
-                    case white_rook: case black_rook: std::cout << "r"; break;
-                    case white_bishop: case black_bishop: std::cout << "b"; break;
-                    case white_knight: case black_knight: std::cout << "n"; break;
+            if (move.type() == PROMOTION) {
+                switch (move.promotionPiece(true)) {
+                    case white_queen: out << "q"; break;
+                    case white_rook: out << "r"; break;
+                    case white_bishop: out << "b"; break;
+                    case white_knight: out << "n"; break;
                     default: break;
                 }
             }
         }
     }
     
-    std::cout << std::endl;
+    UCI::Utils::sendLine(out.str());
 }
 
 } // namespace Search
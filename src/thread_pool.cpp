@@ -0,0 +1,111 @@
+#include "thread_pool.h"
+
+namespace Search {
+
+// ============================================================================
+// SearchThread Implementation
+// ============================================================================
+
+SearchThread::SearchThread(TranspositionTable* tt, int threadId)
+    : board(), moveGen(&board), evaluator(&board), 
+      searcher(&board, &moveGen, &evaluator, tt, threadId) {}
+
+// ============================================================================
+// ThreadPool Implementation
+// ============================================================================
+
+ThreadPool::ThreadPool(TranspositionTable* tt) : tt(tt) {
+    setThreadCount(1);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+    for (auto& t : threads) {
+        if (t->thread.joinable()) t->thread.join();
+    }
+}
+
+void ThreadPool::setThreadCount(int count) {
+    if (count < 1) count = 1;
+    
+    threads.clear();
+    for (int i = 0; i < count; i++) {
+        threads.push_back(std::make_unique<SearchThread>(tt, i));
+    }
+    
+    // The main thread reports node counts for everyone
+    std::vector<const Worker*> helpers;
+    for (int i = 1; i < count; i++) {
+        helpers.push_back(&threads[i]->searcher);
+    }
+    threads[0]->searcher.setPeers(helpers);
+}
+
+void ThreadPool::prepare(const Board& root, const SearchLimits& limits) {
+    for (auto& t : threads) {
+        t->board = root;
+        t->result = SearchResult();
+        t->searcher.prepare(limits.ponder);
+    }
+}
+
+SearchResult ThreadPool::search(const Board& root, const SearchLimits& limits) {
+    prepare(root, limits);
+    return run(limits);
+}
+
+SearchResult ThreadPool::run(const SearchLimits& limits) {
+    // Helpers search until the main thread is done
+    SearchLimits helperLimits;
+    helperLimits.maxDepth = limits.maxDepth;
+    helperLimits.contempt = limits.contempt;
+    helperLimits.infinite = true;
+    
+    for (size_t i = 1; i < threads.size(); i++) {
+        SearchThread* t = threads[i].get();
+        t->thread = std::thread([t, helperLimits]() {
+            t->result = t->searcher.search(helperLimits);
+        });
+    }
+    
+    SearchThread* main = threads[0].get();
+    main->result = main->searcher.search(limits);
+    
+    for (size_t i = 1; i < threads.size(); i++) {
+        threads[i]->searcher.stop();
+    }
+    for (size_t i = 1; i < threads.size(); i++) {
+        threads[i]->thread.join();
+    }
+    
+    // Prefer the deepest completed iteration, then the higher score
+    SearchResult best = main->result;
+    for (size_t i = 1; i < threads.size(); i++) {
+        const SearchResult& r = threads[i]->result;
+        if (r.bestMove.isNull()) continue;
+        if (r.depth > best.depth || (r.depth == best.depth && r.score > best.score)) {
+            best = r;
+        }
+    }
+    
+    best.stats.nodes = 0;
+    best.stats.qnodes = 0;
+    for (auto& t : threads) {
+        best.stats.nodes += t->searcher.getStats().nodes;
+        best.stats.qnodes += t->searcher.getStats().qnodes;
+    }
+    
+    return best;
+}
+
+void ThreadPool::stop() {
+    for (auto& t : threads) {
+        t->searcher.stop();
+    }
+}
+
+void ThreadPool::ponderhit() {
+    threads[0]->searcher.ponderhit();
+}
+
+} // namespace Search
@@ -0,0 +1,144 @@
+#include "tt.h"
+#include "search.h"
+#include <algorithm>
+
+namespace Search {
+
+// ============================================================================
+// TranspositionTable Implementation
+// ============================================================================
+
+TranspositionTable::TranspositionTable() : bucketCount(0), generation(0) {}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = megabytes * 1024 * 1024 / sizeof(Bucket);
+    if (count == 0) count = 1;
+    
+    // make_unique value-initialises the entries, a clear() on top would
+    // touch the whole table a second time
+    buckets.reset();
+    buckets = std::make_unique<Bucket[]>(count);
+    bucketCount = count;
+    generation = 0;
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; i++) {
+        for (auto& entry : buckets[i].entries) {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & 0x3F;
+}
+
+TranspositionTable::Bucket& TranspositionTable::bucketFor(uint64_t key) const {
+    // Map the key onto [0, bucketCount) without a division
+    size_t index = static_cast<size_t>((static_cast<unsigned __int128>(key) * bucketCount) >> 64);
+    return buckets[index];
+}
+
+uint64_t TranspositionTable::pack(const Move& move, int score, int depth, Bound bound, uint8_t generation) {
+    return static_cast<uint64_t>(move.data)
+         | (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 16)
+         | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 48)
+         | (static_cast<uint64_t>(bound) << 56)
+         | (static_cast<uint64_t>(generation & 0x3F) << 58);
+}
+
+TTData TranspositionTable::unpack(uint64_t data) {
+    TTData result;
+    result.move.data = static_cast<uint16_t>(data);
+    result.score = static_cast<int32_t>(static_cast<uint32_t>(data >> 16));
+    result.depth = static_cast<uint8_t>(data >> 48);
+    result.bound = static_cast<Bound>((data >> 56) & 0x3);
+    return result;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& data) const {
+    if (bucketCount == 0) return false;
+    
+    Bucket& bucket = bucketFor(key);
+    for (auto& entry : bucket.entries) {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.keyXorData.load(std::memory_order_relaxed);
+        
+        if ((check ^ packed) == key && packed != 0) {
+            data = unpack(packed);
+            return data.bound != BOUND_NONE;
+        }
+    }
+    
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const Move& move, int score, int depth, Bound bound) {
+    if (bucketCount == 0) return;
+    
+    Bucket& bucket = bucketFor(key);
+    Entry* replace = &bucket.entries[0];
+    int worstValue = 1 << 30;
+    
+    for (auto& entry : bucket.entries) {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.keyXorData.load(std::memory_order_relaxed);
+        
+        // Same position: always overwrite, but keep a known move
+        if ((check ^ packed) == key) {
+            Move keep = move.isNull() ? unpack(packed).move : move;
+            uint64_t data = pack(keep, score, depth, bound, generation);
+            entry.data.store(data, std::memory_order_relaxed);
+            entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+            return;
+        }
+        
+        // Prefer replacing shallow entries and entries from earlier searches
+        int age = (generation - generationOf(packed)) & 0x3F;
+        int value = static_cast<uint8_t>(packed >> 48) - 8 * age;
+        if (value < worstValue) {
+            worstValue = value;
+            replace = &entry;
+        }
+    }
+    
+    uint64_t data = pack(move, score, depth, bound, generation);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(250, bucketCount);
+    if (sample == 0) return 0;
+    
+    int used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        for (auto& entry : buckets[i].entries) {
+            uint64_t packed = entry.data.load(std::memory_order_relaxed);
+            if (packed != 0 && generationOf(packed) == generation) used++;
+        }
+    }
+    
+    return static_cast<int>(used * 1000 / (sample * 4));
+}
+
+// ============================================================================
+// Mate score adjustment
+// ============================================================================
+
+int scoreToTT(int score, int ply) {
+    if (score > MATE_THRESHOLD) return score + ply;
+    if (score < -MATE_THRESHOLD) return score - ply;
+    return score;
+}
+
+int scoreFromTT(int score, int ply) {
+    if (score > MATE_THRESHOLD) return score - ply;
+    if (score < -MATE_THRESHOLD) return score + ply;
+    return score;
+}
+
+} // namespace Search
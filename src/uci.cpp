@@ -1,4 +1,6 @@
 #include "uci.h"
+#include "bench.h"
+#include "perft.h"
 #include <iostream>
 #include <sstream>
 #include <chrono>
@@ -11,7 +13,8 @@ namespace UCI {
 // ============================================================================
 
 ChessEngine::ChessEngine() 
-    : searching(false), quit(false) {
+    : threads(&tt), searching(false), quit(false), 
+      stopRequested(false), pondering(false), infiniteSearch(false) {
 }
 
 ChessEngine::~ChessEngine() {
@@ -19,8 +22,7 @@ ChessEngine::~ChessEngine() {
 }
 
 void ChessEngine::init() {
-    // Initialize attack tables first
-    MoveGenerator::AttackTables::initialize();
+    tt.resize(options.hashSize);
     
     // Create initial position
     board = std::make_unique<Board>();
@@ -29,8 +31,6 @@ void ChessEngine::init() {
 
 void ChessEngine::recreateWorkers() {
     moveGen = std::make_unique<MoveGenerator::Worker>(board.get());
-    evaluator = std::make_unique<Eval::Worker>(board.get());
-    searcher = std::make_unique<Search::Worker>(board.get(), moveGen.get(), evaluator.get());
 }
 
 void ChessEngine::newGame() {
@@ -39,9 +39,12 @@ void ChessEngine::newGame() {
     // Reset to starting position
     board = std::make_unique<Board>();
     recreateWorkers();
+    tt.clear();
 }
 
 void ChessEngine::setPosition(const std::string& fen, const std::vector<std::string>& moves) {
+    stopSearch();
+    
     // Set position from FEN
     if (fen == "startpos") {
         board = std::make_unique<Board>();
@@ -67,62 +70,73 @@ bool ChessEngine::applyMove(const std::string& moveStr) {
     
     Move move = Utils::parseUCIMove(moveStr, board.get());
     
-    if (move.from == 0 && move.to == 0) {
+    if (move.isNull()) {
         return false;
     }
     
     // Verify it's a legal move
-    std::vector<Move> pseudoMoves = moveGen->generateAllMoves();
-    std::vector<Move> legalMoves = moveGen->filterLegalMoves(pseudoMoves);
+    MoveList legalMoves;
+    moveGen->generateLegalMoves(legalMoves);
     
     for (const auto& legal : legalMoves) {
-        if (legal.from == move.from && legal.to == move.to) {
-            // Handle promotion
-            if (move.type == PROMOTION) {
-                // Find the matching promotion piece
-                for (const auto& promo : legalMoves) {
-                    if (promo.from == move.from && promo.to == move.to && 
-                        promo.promotionPiece == move.promotionPiece) {
-                        return board->makeMove(promo);
-                    }
-                }
-            }
-            return board->makeMove(legal);
+        if (legal.move == move) {
+            if (!board->makeMove(legal.move)) return false;
+            
+            // Game moves are never taken back, keep the state stack for the search
+            board->setRoot();
+            return true;
         }
     }
     
     return false;
 }
 
-void ChessEngine::startSearch(const Search::SearchLimits& limits) {
-    if (searching) stopSearch();
+void ChessEngine::startSearch(const Search::SearchLimits& goLimits) {
+    stopSearch();
+    
+    Search::SearchLimits limits = goLimits;
+    limits.contempt = options.contempt;
+    
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        stopRequested = false;
+        pondering = limits.ponder;
+        infiniteSearch = limits.infinite;
+    }
     
+    // Arm every worker before the thread starts so an early stop is not lost
+    threads.prepare(*board, limits);
     searching = true;
     
-    // Launch search in separate thread
     searchThread = std::thread([this, limits]() {
         searchThreadFunc(limits);
     });
-    
-    // Wait for search to complete
-    searchThread.join();
 }
 
 void ChessEngine::searchThreadFunc(const Search::SearchLimits& limits) {
-    Search::SearchResult result = searcher->search(limits);
+    Search::SearchResult result = threads.run(limits);
+    
+    // UCI forbids bestmove during 'go infinite' or 'go ponder' until stop / ponderhit
+    {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCondition.wait(lock, [this]() {
+            return stopRequested || (!infiniteSearch && !pondering);
+        });
+    }
     
     // Send best move
-    if (result.bestMove.from != 0 || result.bestMove.to != 0) {
-        Utils::sendBestMove(result.bestMove);
+    if (!result.bestMove.isNull()) {
+        Move ponderMove = result.pv.size() > 1 ? result.pv[1] : Move();
+        Utils::sendBestMove(result.bestMove, ponderMove);
     } else {
         // No legal moves found - might be checkmate or stalemate
-        std::vector<Move> pseudoMoves = moveGen->generateAllMoves();
-        std::vector<Move> legalMoves = moveGen->filterLegalMoves(pseudoMoves);
+        MoveList legalMoves;
+        moveGen->generateLegalMoves(legalMoves);
         
         if (!legalMoves.empty()) {
-            Utils::sendBestMove(legalMoves[0]);
+            Utils::sendBestMove(legalMoves[0].move);
         } else {
-            std::cout << "bestmove (none)" << std::endl;
+            Utils::sendLine("bestmove (none)");
         }
     }
     
@@ -130,14 +144,40 @@ void ChessEngine::searchThreadFunc(const Search::SearchLimits& limits) {
 }
 
 void ChessEngine::stopSearch() {
-    if (searching && searcher) {
-        searcher->stop();
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        stopRequested = true;
+    }
+    waitCondition.notify_all();
+    threads.stop();
+    
+    // Wait for search thread to finish (it sends bestmove before exiting)
+    if (searchThread.joinable()) {
+        searchThread.join();
     }
     
     searching = false;
+}
+
+void ChessEngine::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        pondering = false;
+    }
+    threads.ponderhit();
+    waitCondition.notify_all();
+}
+
+void ChessEngine::waitForSearch() {
+    bool endsOnStop;
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        endsOnStop = infiniteSearch || pondering;
+    }
     
-    // Wait for search thread to finish
-    if (searchThread.joinable()) {
+    if (endsOnStop) {
+        stopSearch();
+    } else if (searchThread.joinable()) {
         searchThread.join();
     }
 }
@@ -145,15 +185,17 @@ void ChessEngine::stopSearch() {
 void ChessEngine::setOption(const std::string& name, const std::string& value) {
     if (name == "Hash") {
         try {
-            options.hashSize = std::stoi(value);
-            // TODO: Resize hash table
+            options.hashSize = std::clamp(std::stoi(value), 1, 16384);
+            stopSearch();
+            tt.resize(options.hashSize);
         } catch (...) {
             std::cerr << "info string Invalid Hash value: " << value << std::endl;
         }
     } else if (name == "Threads") {
         try {
-            options.threads = std::stoi(value);
-            // TODO: Update thread count
+            options.threads = std::clamp(std::stoi(value), 1, 256);
+            stopSearch();
+            threads.setThreadCount(options.threads);
         } catch (...) {
             std::cerr << "info string Invalid Threads value: " << value << std::endl;
         }
@@ -161,7 +203,7 @@ void ChessEngine::setOption(const std::string& name, const std::string& value) {
         options.ownBook = (value == "true");
     } else if (name == "Contempt") {
         try {
-            options.contempt = std::stoi(value);
+            options.contempt = std::clamp(std::stoi(value), -100, 100);
         } catch (...) {
             std::cerr << "info string Invalid Contempt value: " << value << std::endl;
         }
@@ -175,11 +217,13 @@ void ChessEngine::setOption(const std::string& name, const std::string& value) {
 Protocol::Protocol() {
 }
 
-void Protocol::run() {
+void Protocol::run(std::istream& input) {
     engine.init();
     
+    // Searches run in the background, so this loop keeps reading
+    // (stop, isready, ponderhit, quit) while the engine thinks
     std::string line;
-    while (std::getline(std::cin, line) && !engine.shouldQuit()) {
+    while (!engine.shouldQuit() && std::getline(input, line)) {
         std::istringstream iss(line);
         std::string command;
         iss >> command;
@@ -196,6 +240,8 @@ void Protocol::run() {
             handleGo(iss);
         } else if (command == "stop") {
             handleStop();
+        } else if (command == "ponderhit") {
+            handlePonderHit();
         } else if (command == "setoption") {
             handleSetOption(iss);
         } else if (command == "quit") {
@@ -204,25 +250,32 @@ void Protocol::run() {
             handleDisplay();
         } else if (command == "perft") {
             handlePerft(iss);
+        } else if (command == "divide") {
+            handleDivide(iss);
+        } else if (command == "bench") {
+            handleBench(iss);
         }
     }
+    
+    // Input closed: let a running fixed-limit search finish and report
+    engine.waitForSearch();
 }
 
 void Protocol::handleUCI() {
-    std::cout << "id name ChessAI 1.0" << std::endl;
-    std::cout << "id author Ranadi" << std::endl;
+    Utils::sendLine("id name ChessAI 1.0");
+    Utils::sendLine("id author Ranadi");
     
     // Send available options
-    std::cout << "option name Hash type spin default 128 min 1 max 16384" << std::endl;
-    std::cout << "option name Threads type spin default 1 min 1 max 256" << std::endl;
-    std::cout << "option name OwnBook type check default false" << std::endl;
-    std::cout << "option name Contempt type spin default 0 min -100 max 100" << std::endl;
+    Utils::sendLine("option name Hash type spin default 128 min 1 max 16384");
+    Utils::sendLine("option name Threads type spin default 1 min 1 max 256");
+    Utils::sendLine("option name OwnBook type check default false");
+    Utils::sendLine("option name Contempt type spin default 0 min -100 max 100");
     
-    std::cout << "uciok" << std::endl;
+    Utils::sendLine("uciok");
 }
 
 void Protocol::handleIsReady() {
-    std::cout << "readyok" << std::endl;
+    Utils::sendLine("readyok");
 }
 
 void Protocol::handleNewGame() {
@@ -291,6 +344,8 @@ Search::SearchLimits Protocol::parseGoLimits(std::istringstream& input) {
             input >> limits.movestogo;
         } else if (token == "infinite") {
             limits.infinite = true;
+        } else if (token == "ponder") {
+            limits.ponder = true;
         }
     }
     
@@ -301,6 +356,10 @@ void Protocol::handleStop() {
     engine.stopSearch();
 }
 
+void Protocol::handlePonderHit() {
+    engine.ponderHit();
+}
+
 void Protocol::handleSetOption(std::istringstream& input) {
     std::string token;
     input >> token; // Should be "name"
@@ -333,14 +392,113 @@ void Protocol::handleQuit() {
 
 void Protocol::handleDisplay() {
     // Debug command to display current board (not part of UCI standard)
-    std::cout << "info string Board display not implemented" << std::endl;
+    Utils::sendLine("info string Board display not implemented");
 }
 
 void Protocol::handlePerft(std::istringstream& input) {
     // Perft command for testing move generation
+    std::string token;
+    input >> token;
+    
+    if (token == "suite") {
+        int maxDepth = 0;
+        input >> maxDepth;
+        Perft::runSuite(maxDepth);
+        return;
+    }
+    
+    if (token == "verify") {
+        int maxDepth = 4;
+        input >> maxDepth;
+        Perft::runVerify(maxDepth);
+        return;
+    }
+    
+    if (token == "tables") {
+        int maxDepth = 4;
+        input >> maxDepth;
+        Perft::runTables(maxDepth);
+        return;
+    }
+    
+    int depth = 1;
+    try {
+        depth = std::max(1, std::stoi(token));
+    } catch (...) {
+        std::cerr << "info string Invalid perft depth: " << token << std::endl;
+        return;
+    }
+    
+    // perft <depth> threads <n> [hash <mb>]
+    int threads = 0;
+    size_t hashMb = 0;
+    while (input >> token) {
+        if (token == "threads") input >> threads;
+        else if (token == "hash") input >> hashMb;
+    }
+    
+    if (threads > 0) {
+        Perft::runThreads(engine.getBoard(), depth, threads, hashMb);
+        return;
+    }
+    
+    Board board = engine.getBoard();
+    Perft::Worker perft(&board);
+    perft.run(depth);
+}
+
+void Protocol::handleDivide(std::istringstream& input) {
     int depth = 1;
     input >> depth;
-    std::cout << "info string Perft not implemented" << std::endl;
+    
+    Board board = engine.getBoard();
+    Perft::Worker perft(&board);
+    perft.divide(std::max(1, depth));
+}
+
+void Protocol::handleBench(std::istringstream& input) {
+    std::string token;
+    input >> token;
+    
+    if (token == "stop") {
+        int iterations = 20;
+        input >> iterations;
+        Bench::runStopLatency(std::max(1, iterations));
+        return;
+    }
+    
+    if (token == "eval") {
+        int games = 100;
+        input >> games;
+        Bench::runEvalCheck(std::max(1, games));
+        return;
+    }
+    
+    if (token == "batch") {
+        int count = 1024;
+        input >> count;
+        Bench::runBatch(std::clamp(count, 1, 4096));
+        return;
+    }
+    
+    if (token == "threads") {
+        int maxThreads = 1;
+        int moveTime = 1000;
+        input >> maxThreads >> moveTime;
+        Bench::runThreads(std::max(1, maxThreads), moveTime);
+        return;
+    }
+    
+    int depth = 5;
+    if (!token.empty()) {
+        try {
+            depth = std::stoi(token);
+        } catch (...) {
+            std::cerr << "info string Invalid bench depth: " << token << std::endl;
+            return;
+        }
+    }
+    Bench::run(depth);
 }
 
 // ============================================================================
@@ -352,10 +510,10 @@ namespace Utils {
 std::string moveToUCI(const Move& move) {
     std::string uci;
     
-    int fromFile = (move.from - 1) % 8;
-    int fromRank = (move.from - 1) / 8;
-    int toFile = (move.to - 1) % 8;
-    int toRank = (move.to - 1) / 8;
+    int fromFile = move.from() % 8;
+    int fromRank = move.from() / 8;
+    int toFile = move.to() % 8;
+    int toRank = move.to() / 8;
     
     uci += static_cast<char>('a' + fromFile);
     uci += static_cast<char>('1' + fromRank);
@@ -363,12 +521,12 @@ std::string moveToUCI(const Move& move) {
     uci += static_cast<char>('1' + toRank);
     
     // Add promotion piece if applicable
-    if (move.type == PROMOTION) {
-        switch (move.promotionPiece) {
-            case white_queen: case black_queen: uci += "q"; break;
-            case white_rook: case black_rook: uci += "r"; break;
-            case white_bishop: case black_bishop: uci += "b"; break;
-            case white_knight: case black_knight: uci += "n"; break;
+    if (move.type() == PROMOTION) {
+        switch (move.promotionPiece(true)) {
+            case white_queen: uci += "q"; break;
+            case white_rook: uci += "r"; break;
+            case white_bishop: uci += "b"; break;
+            case white_knight: uci += "n"; break;
             default: break;
         }
     }
@@ -392,25 +550,20 @@ Move parseUCIMove(const std::string& uciMove, Board* board) {
         return Move();
     }
     
-    int fromSquare = fromRank * 8 + fromFile + 1;  // 1-based
-    int toSquare = toRank * 8 + toFile + 1;        // 1-based
-    
-    Move move(fromSquare, toSquare, uciMove);
+    int fromSquare = fromRank * 8 + fromFile;
+    int toSquare = toRank * 8 + toFile;
     
     // Detect move type
-    int piece = board->getPieceAt(fromSquare);
-    int captured = board->getPieceAt(toSquare);
-    
-    // Check for capture
-    if (captured != -1) {
-        move.type = CAPTURE;
-    }
+    int piece = board->getPieceAt(fromSquare + 1);
+    int captured = board->getPieceAt(toSquare + 1);
+    MoveType type = NORMAL;
+    PieceType promotion = white_queen;
     
     // Check for castling
     if (piece == white_king || piece == black_king) {
         int fileDiff = toFile - fromFile;
         if (std::abs(fileDiff) == 2) {
-            move.type = CASTLING;
+            type = CASTLING;
         }
     }
     
@@ -418,45 +571,49 @@ Move parseUCIMove(const std::string& uciMove, Board* board) {
     if (piece == white_pawn || piece == black_pawn) {
         // En passant
         if (fromFile != toFile && captured == -1) {
-            move.type = EN_PASSANT;
+            type = EN_PASSANT;
         }
         
-        // Promotion
+        // Promotion (defaults to queen)
         if (toRank == 7 || toRank == 0) {
-            move.type = PROMOTION;
-            
-            // Default to queen promotion
-            PieceType promoBase = (piece == white_pawn) ? white_queen : black_queen;
+            type = PROMOTION;
             
             if (uciMove.length() >= 5) {
-                char promo = uciMove[4];
-                bool isWhite = (piece == white_pawn);
-                
-                switch (promo) {
-                    case 'q': move.promotionPiece = isWhite ? white_queen : black_queen; break;
-                    case 'r': move.promotionPiece = isWhite ? white_rook : black_rook; break;
-                    case 'b': move.promotionPiece = isWhite ? white_bishop : black_bishop; break;
-                    case 'n': move.promotionPiece = isWhite ? white_knight : black_knight; break;
-                    default: move.promotionPiece = promoBase; break;
+                switch (uciMove[4]) {
+                    case 'r': promotion = white_rook; break;
+                    case 'b': promotion = white_bishop; break;
+                    case 'n': promotion = white_knight; break;
+                    default: break;
                 }
-            } else {
-                move.promotionPiece = promoBase;
             }
         }
     }
     
-    return move;
+    return Move(fromSquare, toSquare, type, promotion);
 }
 
 void sendBestMove(const Move& bestMove, const Move& ponderMove) {
-    std::cout << "bestmove " << moveToUCI(bestMove);
+    std::string line = "bestmove " + moveToUCI(bestMove);
     
     // Optionally send ponder move
-    if (ponderMove.from != 0 && ponderMove.to != 0) {
-        std::cout << " ponder " << moveToUCI(ponderMove);
+    if (!ponderMove.isNull()) {
+        line += " ponder " + moveToUCI(ponderMove);
     }
     
-    std::cout << std::endl;
+    sendLine(line);
+}
+
+static std::mutex outputMutex;
+static std::ostream* output = &std::cout;
+
+void sendLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    *output << line + "\n" << std::flush;
+}
+
+void setOutput(std::ostream& stream) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    output = &stream;
 }
 
 } // namespace Utils
@@ -0,0 +1,47 @@
+#include "zobrist.h"
+#include "board.h"
+#include <initializer_list>
+
+namespace Zobrist {
+
+uint64_t computeKey(const Board& board) {
+    uint64_t key = 0;
+    
+    for (int piece = white_pawn; piece <= black_king; piece++) {
+        uint64_t bb = board.positions[piece];
+        while (bb) {
+            int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            key ^= keys.pieces[piece][sq];
+        }
+    }
+    
+    key ^= castlingKey(board.getPackedInfo());
+    
+    if (board.positions[en_passant]) {
+        key ^= keys.enPassant[__builtin_ctzll(board.positions[en_passant]) % 8];
+    }
+    
+    if (!(board.getPackedInfo() & 1)) {
+        key ^= keys.side;
+    }
+    
+    return key;
+}
+
+uint64_t computePawnKey(const Board& board) {
+    uint64_t key = 0;
+    
+    for (int piece : {white_pawn, black_pawn}) {
+        uint64_t bb = board.positions[piece];
+        while (bb) {
+            int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            key ^= keys.pieces[piece][sq];
+        }
+    }
+    
+    return key;
+}
+
+} // namespace Zobrist